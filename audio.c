@@ -0,0 +1,94 @@
+#include <math.h>
+#include <string.h>
+
+#include "audio.h"
+#include "simd.h"
+
+#define PI 3.14159265358979323846
+
+//lanes of a where m is set, else b
+static inline vf_t blendf(v32_t m , vf_t a , vf_t b) {
+    return (vf_t)(((v32_t)a & m) | ((v32_t)b & ~m)) ;
+}
+
+static inline float clampf(float v) {
+    return v > 32767.0f ? 32767.0f : v < -32767.0f ? -32767.0f : v ;
+}
+
+//polyphase windowed sinc table for the current pitch
+//upsampling keeps the full source band, downsampling lowers the cutoff to the device Nyquist
+static void build_taps(xo_audio_t *a) {
+    const double src_rate = 4000.0 * pow(2.0, (a -> pitch - 64) / 48.0) ;
+    const double ratio = src_rate / a -> out_rate ;
+    const double fc = ratio > 1.0 ? 1.0 / ratio : 1.0 ;
+
+    a -> step = (uint64_t)(ratio * 4294967296.0) ;
+    for ( uint32_t p = 0 ; p < AUDIO_PHASES ; p ++) {
+        const double frac = (double)p / AUDIO_PHASES ;
+        double h[AUDIO_TAPS] , sum = 0 ;
+        for ( uint32_t k = 0 ; k < AUDIO_TAPS ; k ++) {
+            const double t = (double)k - (AUDIO_TAPS/2 - 1) - frac ;  //distance from the read position
+            const double x = PI * fc * t ;
+            const double sinc = x == 0 ? 1.0 : sin(x) / x ;
+            const double w = 0.42 + 0.5 * cos(2*PI * t / AUDIO_TAPS) + 0.08 * cos(4*PI * t / AUDIO_TAPS) ; //Blackman
+            h[k] = sinc * w ;
+            sum += h[k] ;
+        }
+        for ( uint32_t k = 0 ; k < AUDIO_TAPS ; k ++) a -> taps[p][k] = h[k] / sum ; //unity gain at DC
+    }
+}
+
+void xo_audio_init(xo_audio_t *a , uint32_t out_rate , int16_t volume) {
+    memset(a, 0, sizeof *a) ;
+    a -> out_rate = out_rate ;
+    a -> volume = volume ;
+    a -> pitch = 64 ;
+    xo_audio_set(a, a -> pattern, 64) ;
+    build_taps(a) ;
+}
+
+void xo_audio_set(xo_audio_t *a , const uint8_t pattern[16] , uint8_t pitch) {
+    memmove(a -> pattern, pattern, sizeof a -> pattern) ;
+    for ( uint32_t j = 0 ; j < 128 + AUDIO_TAPS ; j ++) {
+        const uint32_t bit = (j - (AUDIO_TAPS/2 - 1)) & 127 ;
+        a -> source[j] = (a -> pattern[bit >> 3] >> (7 - (bit & 7))) & 1 ? 1.0f : -1.0f ;
+    }
+    if ( pitch != a -> pitch) {
+        a -> pitch = pitch ;
+        build_taps(a) ;
+    }
+}
+
+void xo_audio_render(xo_audio_t *a , int16_t *out , uint32_t n) {
+    const uint64_t wrap = (128ull << 32) - 1 ;
+    float block[AUDIO_BLOCK] ;
+
+    for ( uint32_t done = 0 ; done < n ; done += AUDIO_BLOCK) {
+        const uint32_t count = n - done < AUDIO_BLOCK ? n - done : AUDIO_BLOCK ;
+
+        //filter: one dot product of AUDIO_TAPS source samples per output sample
+        for ( uint32_t i = 0 ; i < count ; i ++) {
+            const float *src = &a -> source[a -> pos >> 32] ;
+            const float *h = a -> taps[(a -> pos >> (32 - AUDIO_PHASE_BITS)) & (AUDIO_PHASES - 1)] ;
+            vf_t acc = ldf(src) * ldf(h) ;
+            for ( uint32_t k = VFLOATS ; k < AUDIO_TAPS ; k += VFLOATS) acc += ldf(src + k) * ldf(h + k) ;
+            float y = 0 ;
+            for ( uint32_t l = 0 ; l < VFLOATS ; l ++) y += acc[l] ;
+            block[i] = y ;
+            a -> pos = (a -> pos + a -> step) & wrap ;
+        }
+
+        //scale, clip the sinc overshoot and convert the block
+        const vf_t vol = (vf_t){0} + a -> volume ;
+        const vf_t hi = (vf_t){0} + 32767.0f ;
+        const vf_t lo = (vf_t){0} - 32767.0f ;
+        uint32_t i = 0 ;
+        for ( ; i + VFLOATS <= count ; i += VFLOATS) {
+            vf_t v = ldf(&block[i]) * vol ;
+            v = blendf((v32_t)(v > hi), hi, v) ;
+            v = blendf((v32_t)(v < lo), lo, v) ;
+            for ( uint32_t l = 0 ; l < VFLOATS ; l ++) out[done + i + l] = (int16_t)v[l] ;
+        }
+        for ( ; i < count ; i ++) out[done + i] = (int16_t)clampf(block[i] * a -> volume) ;
+    }
+}
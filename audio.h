@@ -0,0 +1,36 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//XO-CHIP audio: the 128 bit pattern played as 1 bit samples at 4000*2^((pitch-64)/48) Hz,
+//resampled to the device rate with a windowed sinc (band-limited, no aliasing buzz)
+//the pattern loops, so the source is a fixed 128 sample ring and the filter is a
+//polyphase table rebuilt only when the pitch changes
+
+#define AUDIO_TAPS    16   //filter length in source samples, a multiple of the vector width
+#define AUDIO_PHASE_BITS 7
+#define AUDIO_PHASES  (1 << AUDIO_PHASE_BITS) //fractional positions the filter is tabulated at
+#define AUDIO_BLOCK   64   //samples mixed per block before conversion to 16 bit
+
+typedef struct {
+    uint32_t out_rate ;       //device sample rate
+    int16_t volume ;
+    uint8_t pattern[16] ;     //pattern and pitch the tables were built from
+    uint8_t pitch ;
+    float source[128 + AUDIO_TAPS] ; //pattern bits as -1/+1, source[j] = bit (j - AUDIO_TAPS/2 + 1) mod 128
+    float taps[AUDIO_PHASES][AUDIO_TAPS] ;
+    uint64_t pos ;            //read position in the pattern, 32.32 fixed point, wraps at 128
+    uint64_t step ;           //source samples per output sample, 32.32 fixed point
+} xo_audio_t ;
+
+void xo_audio_init(xo_audio_t *audio , uint32_t out_rate , int16_t volume) ;
+
+//new pattern and/or pitch, the filter is only rebuilt when the pitch changed
+void xo_audio_set(xo_audio_t *audio , const uint8_t pattern[16] , uint8_t pitch) ;
+
+//fill n mono 16 bit samples
+void xo_audio_render(xo_audio_t *audio , int16_t *out , uint32_t n) ;
+
+#endif //AUDIO_H
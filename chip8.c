@@ -1,130 +1,152 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 
 #include <SDL2/SDL.h>
 
+#include "audio.h"
+#include "chip8.h"
+#include "config.h"
+#include "debugger.h"
+#include "hud.h"
+#include "metrics.h"
+#include "scaler.h"
+
 
 
 // typedef __int32 int32_t;
 // typedef unsigned __int32 uint32_t;
 
+//state shared with the audio callback, only touched with the device locked
+typedef struct {
+    const config_t *config ;
+    bool xo ;                 //XO-CHIP pattern loaded, else the plain square wave
+    xo_audio_t xo_audio ;
+    uint32_t square_index ;   //running sample index of the square wave
+    metrics_t *metrics ;
+    uint64_t period_ticks ;   //one device buffer in performance counter ticks
+    uint64_t last_callback ;  //when the callback last ran
+    bool restart ;            //device was just unpaused, the gap before this callback isn't an underrun
+    bool playing ;            //main thread's view of the device, to spot unpausing
+} audio_state_t ;
+
+//input latency probe: time from a CHIP8 key press to the first presented frame that differs
+//from the one on screen when the key went down; exact on screens that wait for input,
+//an underestimate when the screen was animating anyway
+typedef struct {
+    bool pending ;            //a press is waiting to show up on screen
+    uint32_t pressed_ms ;     //SDL event timestamp of the press
+    uint32_t presents ;       //presents since the press
+    uint64_t shown_hash ;     //display hash of the frame on screen
+} latency_probe_t ;
+
+#define LATENCY_GIVE_UP 30    //presents after which a press is taken to have no visible effect
+
 //sdl container
 typedef struct {
     SDL_Window *window ;
     SDL_Renderer *renderer ;
     SDL_AudioSpec want , have ;
     SDL_AudioDeviceID audio_device_id;
+    SDL_Texture *texture ;    //window sized streaming texture for the scaler
+    scaler_t *scaler ;        //software scaler output, NULL with the rects renderer
+    audio_state_t *audio ;    //audio callback data
+    hud_t *hud ;              //performance overlay
+    metrics_t *metrics ;      //performance counters
+    latency_probe_t *latency ; //key to present latency probe
 } sdl_t ;
 
-//configuration 
+//frame pacing, decides which emulated frames actually get presented
 typedef struct {
-    uint32_t window_width; 
-    uint32_t window_height ;
-    uint32_t fg_color ; //foreground RGBA
-    uint32_t bg_color ; //background RGBA
-    uint32_t scale_factor; //number of windows pixels one chip8 pixel will be
-    bool pixel_outlines ;
-    uint32_t clock_rate ; //instructions per second
-    uint32_t square_freq;  //frequency of square wave to be played
-    uint32_t audio_sample_rate ; 
-    uint16_t volume;       //volume
-} config_t ;
-
-//states of emulator
-typedef enum {
-    QUIT ,
-    RUNNING,
-    PAUSED,
-} emulator_state_t ;
-
-//chip8 instruction format
-typedef struct {
-    //instruction: format DXYN
-    // 4*4=16 bits or 4 hex , that is 4 bits for each letter
-    //D is the instruction type or category(directly implemented while emulating in form of switch case)
-    //note all of these can directly be implemented while emulating, but cmon
-
-    uint16_t opcode ;  //the whole instruction is called opcode
-    uint16_t NNN ;     //12 bit  adress/constant (rightmost 12 bits of opcode)
-    uint8_t NN ;       //8 bit constant (rightmost 8 bits of opcode)
-    uint8_t N ;        //4 bit constant (rightmost 4 bits of opcode)
-    uint8_t X ;        //4 bit register identifier (5th to 8th bit from right)
-    uint8_t Y ;        //4 bit register identifier (9th to 12th bit from right)
+    uint64_t frame_ticks ;    //one emulated 60Hz frame in performance counter ticks
+    uint64_t present_ticks ;  //time between presents (frame_ticks, or host refresh when decoupled)
+    uint64_t next_frame ;     //when the next emulated frame is due
+    uint64_t next_present ;   //when the next present is due (decoupled mode only)
+    uint64_t render_cost ;    //moving average of render_screen() in ticks, for auto skip
+    uint64_t present_slots ;  //presents that were due, for fixed skip
+    uint32_t skipped_in_row ; //consecutive presents dropped by auto skip
+    bool decoupled ;          //presents follow the host refresh (--host-refresh or --vsync)
+    uint64_t vsync_margin ;   //wake this long before a vblank is due, to render in time for it
+} pacer_t ;
 
-} instruction_t ;
-
-//CHIP8 machine
-typedef struct {
-    emulator_state_t state;
-    uint8_t ram[4096] ;      //RAM
-    bool display[64*32] ;     // original CHIP8 resolution
-    uint16_t stack[12] ;      //stack for subroutines(instructions inside instructions, the stack probably stores the addreess of the parent instructions that we have to come back to)
-    uint16_t *stack_top ;      //pointer to top of stack
-    uint8_t V[16] ;           //data registers from V0 to VF(to actually store temporary data)
-    uint16_t I ;              //Index register, register to store indices/locations in memory
-    uint16_t PC;              //program counter, stores address of instruction excecuted 
-    uint8_t delay_timer;      //records delay, executes instruction when>0
-    uint8_t sound_timer;      //plays sound when >0
-    bool keypad[16] ;         //hexadecimal keypad
-    const char *rom_name;     //currently running ROM
-    instruction_t inst;       //currently executing instruction
-} chip8_t ;
+#define MAX_AUTO_SKIP 4   //auto skip still presents at least every 5th frame
 
 
 //sdl audio callback function
 void audio_callback(void *userdata , uint8_t *stream, int len) {
 
-    config_t *config = (config_t *) userdata ;
+    audio_state_t *audio = (audio_state_t *) userdata ;
+    const config_t *config = audio -> config ;
 
     // fill stream with data
     int16_t *audio_data = (int16_t *) stream ;
-    static uint32_t running_sample_index = 0 ; 
+
+    //the device asks for the next buffer as the previous one starts playing,
+    //a callback more than half a buffer late means it ran dry in between
+    const uint64_t now = SDL_GetPerformanceCounter() ;
+    if ( !audio -> restart && now - audio -> last_callback > audio -> period_ticks * 3 / 2)
+        metrics_add(audio -> metrics, METRIC_UNDERRUNS, 1) ;
+    audio -> last_callback = now ;
+    audio -> restart = false ;
+
+    //XO-CHIP: the program's own waveform, resampled to the device rate
+    if ( audio -> xo) {
+        xo_audio_render(&audio -> xo_audio, audio_data, len/2) ;
+        return ;
+    }
+
     const int32_t square_wave_period = config ->audio_sample_rate /config -> square_freq;
     const int32_t half_square_wave_period = square_wave_period/2;
 
     //writing the square wave into audio_data[](bitstream??), filling out 2 bytes at a time ;
     for ( int i = 0 ; i < len/2 ; i ++) {
         //data= +volume and -volume alternatively for square wave
-        audio_data[i] = ((running_sample_index ++ / half_square_wave_period) % 2) ? config -> volume : -config->volume ;
+        audio_data[i] = ((audio -> square_index ++ / half_square_wave_period) % 2) ? config -> volume : -config->volume ;
 
     }
 }
 
-//initialize SDL
-bool init_sdl(sdl_t *sdl ,config_t *config) {
-    if ( SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
-        SDL_Log("Could not initialize SDL subsystems!!! \n %s\n", SDL_GetError()) ;
+//software scaler and the streaming texture it renders into, nothing for the rects renderer
+bool init_scaler(sdl_t *sdl, const config_t *config) {
+    if ( config -> renderer != RENDERER_SCALER) return true ;
+
+    sdl -> scaler = malloc(sizeof *sdl -> scaler) ;
+    if ( !sdl -> scaler || !scaler_init(sdl -> scaler, *config)) {
+        SDL_Log("Could not allocate scaler buffers!!!\n") ;
         return false ;
     }
-
-    sdl->window = SDL_CreateWindow("chip8", SDL_WINDOWPOS_CENTERED,
-                                    SDL_WINDOWPOS_CENTERED,
-                                    config -> window_width * config -> scale_factor, 
-                                    config -> window_height * config -> scale_factor,
-                                    0) ;
-    
-    if ( !sdl->window) {
-        SDL_Log("Window could not be created!!! %s\n", SDL_GetError()) ;
+    sdl -> texture = SDL_CreateTexture(sdl -> renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                                       sdl -> scaler -> out_w, sdl -> scaler -> out_h) ;
+    if ( !sdl -> texture) {
+        SDL_Log("Texture could not be created!!! %s\n", SDL_GetError()) ;
         return false ;
     }
+    return true ;
+}
 
-    sdl->renderer = SDL_CreateRenderer ( sdl->window , -1 , SDL_RENDERER_ACCELERATED) ;
-    if ( !sdl->renderer) {
-        SDL_Log("Renderer could not be created!!! %s\n", SDL_GetError()) ;
-        return false ;
+void free_scaler(sdl_t *sdl) {
+    if ( sdl -> scaler) {
+        scaler_free(sdl -> scaler) ;
+        free(sdl -> scaler) ;
     }
+    if ( sdl -> texture) SDL_DestroyTexture(sdl -> texture) ;
+    sdl -> scaler = NULL ;
+    sdl -> texture = NULL ;
+}
 
-    //init audio stuff
+//open the audio device at config's sample rate and buffer size
+bool open_audio(sdl_t *sdl, const config_t *config) {
     sdl -> want = (SDL_AudioSpec) {
-        .freq = 44100 ,           //"441100Hz" CD quality
+        .freq = config -> audio_sample_rate , //44100Hz CD quality by default
         .format = AUDIO_S16LSB ,  // Signed 16 bit little endian
         .channels = 1 ,           //mono sound
-        .samples = 512 ,
+        .samples = config -> audio_buffer ,
         .callback = audio_callback, //fuction which calls back to get audio data
-        .userdata = config,      //user data is passed to audio callback  
+        .userdata = sdl -> audio, //user data is passed to audio callback
     } ;
 
     sdl -> audio_device_id = SDL_OpenAudioDevice( NULL , 0 , &sdl->want , &sdl->have, 0) ;
@@ -138,96 +160,73 @@ bool init_sdl(sdl_t *sdl ,config_t *config) {
         SDL_Log("Could not get required audio specs!!! %s\n", SDL_GetError()) ;
         return false ;
     }
-
-    return true ; //SUCCESSFULLY INITIALIZED
-}
-
-//setup the configuration function
-bool set_config(config_t *config, const int argc, char **argv) {
-
-    //set deafults
-    *config = (config_t) {
-        .window_width = 64 , //original chip8 x
-        .window_height = 32, //original chip8 y
-        .fg_color = 0xFFFFFFFF, //white
-        .bg_color = 0x0530ADFF, //black
-        .scale_factor = 20, //default size becomes 1280*640
-        .pixel_outlines = true, //default pixel outlines
-        .clock_rate = 700, //default clock rate
-        .square_freq = 440, //440Hz A4
-        .audio_sample_rate = 44100 , //Hz CD quality
-        .volume = 3000,    // out of INT16_MAX
-    } ;
-
-    //override defaults from arguments
-    for ( int i = 1 ; i < argc ; i ++) {
-        (void)argv[i] ;   // prevent compiler error from unused variables
-    }
-
+    //a new device starts over with the square wave, update_timers() hands the XO-CHIP pattern back
+    xo_audio_init(&sdl -> audio -> xo_audio, sdl -> have.freq, config -> volume) ;
+    sdl -> audio -> xo = false ;
+    sdl -> audio -> playing = false ;
+    sdl -> audio -> period_ticks = SDL_GetPerformanceFrequency() * sdl -> have.samples / sdl -> have.freq ;
     return true ;
 }
 
-//Initialize chip8 object
-bool init_chip8 ( chip8_t *chip8, const char rom_name[]) {
-    const uint32_t entry_point = 0x200;  //CHIP8 ROMs are loaded to 0x200
-    const uint8_t  font[] = {
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    } ;
-
-    //load font
-    memcpy(&chip8->ram[0] , font , sizeof(font)) ;
+//initialize SDL
+bool init_sdl(sdl_t *sdl ,config_t *config) {
+    if ( SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
+        SDL_Log("Could not initialize SDL subsystems!!! \n %s\n", SDL_GetError()) ;
+        return false ;
+    }
 
-    //open rom file
-    FILE *rom = fopen(rom_name, "rb") ;  //ROM is the .ch8 file with code/instructions and all 
-    if (!rom) {
-        SDL_Log("Rom file %s can't be opened, is invalid or non-existent!!!\n", rom_name) ;
-        return false;
+    sdl->window = SDL_CreateWindow("chip8", SDL_WINDOWPOS_CENTERED,
+                                    SDL_WINDOWPOS_CENTERED,
+                                    config -> window_width * config -> scale_factor, 
+                                    config -> window_height * config -> scale_factor,
+                                    0) ;
+    
+    if ( !sdl->window) {
+        SDL_Log("Window could not be created!!! %s\n", SDL_GetError()) ;
+        return false ;
     }
-    fseek(rom , 0 , SEEK_END) ;
-    const size_t rom_size = ftell(rom) ;
-    const size_t max_size = sizeof(chip8->ram) - entry_point;
 
-    if ( rom_size > max_size) {
-        SDL_Log("Rom file %s is tooo bigg!!! ROM size: %u , max availible CHIP8 memory: %u\n", rom_name, (unsigned)rom_size, (unsigned)max_size) ;
-        return false;
+    sdl->renderer = SDL_CreateRenderer ( sdl->window , -1 , SDL_RENDERER_ACCELERATED | (config -> vsync ? SDL_RENDERER_PRESENTVSYNC : 0)) ;
+    if ( !sdl->renderer) {
+        SDL_Log("Renderer could not be created!!! %s\n", SDL_GetError()) ;
+        return false ;
     }
 
+    if ( !init_scaler(sdl, config)) return false ;
 
-    rewind(rom) ; // seek to beginning of file
-    if( fread( &chip8->ram[entry_point] , rom_size , 1 , rom) != 1) { //load ROM data into RAM here
-        SDL_Log("Could not read rom file %s into CHIP8 memory", rom_name) ;
-        return false;
+    //performance counters and their overlay
+    sdl -> metrics = calloc(1, sizeof *sdl -> metrics) ;
+    sdl -> hud = calloc(1, sizeof *sdl -> hud) ;
+    sdl -> latency = calloc(1, sizeof *sdl -> latency) ;
+    if ( !sdl -> metrics || !sdl -> hud || !sdl -> latency) {
+        SDL_Log("Could not allocate metrics!!!\n") ;
+        return false ;
     }
-    fclose(rom) ; // close file after loading
+    sdl -> hud -> visible = config -> show_hud ;
 
-    //Set CHIP8 machine defaults
-    chip8 -> state = RUNNING ; //default machine state
-    chip8 -> PC = entry_point ; // Start program where ROM instructions start
-    chip8 -> stack_top = chip8 -> stack ;
-    chip8 -> rom_name = rom_name ;
-    return true ;
+    //init audio stuff
+    sdl -> audio = calloc(1, sizeof *sdl -> audio) ;
+    if ( !sdl -> audio) {
+        SDL_Log("Could not allocate audio state!!!\n") ;
+        return false ;
+    }
+    sdl -> audio -> config = config ;
+    sdl -> audio -> metrics = sdl -> metrics ;
+    if ( !open_audio(sdl, config)) return false ;
+
+    return true ; //SUCCESSFULLY INITIALIZED
 }
 
 //final cleanup
-void final_cleanup(const sdl_t sdl) {
+void final_cleanup(sdl_t sdl) {
+    free_scaler(&sdl) ;
     SDL_DestroyRenderer(sdl.renderer) ;
     SDL_DestroyWindow(sdl.window) ;
     SDL_CloseAudioDevice(sdl.audio_device_id) ;
+    free(sdl.audio) ;
+    free(sdl.hud) ;
+    free(sdl.metrics) ;
+    free(sdl.latency) ;
     SDL_Quit() ; // SHUT EVERYTHING BEFORE FINISHING PROGRAM
 }
 
@@ -241,8 +240,18 @@ void clear_screen(const sdl_t sdl, const config_t config ) {
     SDL_RenderClear(sdl.renderer) ;
 }
 
-//update screen after instructions have been processed each cycle
-void update_screen(const sdl_t sdl , const config_t config , chip8_t *chip8) {
+//draw the frame into the back buffer, SDL_RenderPresent() shows it
+//kept apart from the present so a present blocking on vsync isn't counted as render time
+void render_screen(const sdl_t sdl , const config_t config , chip8_t *chip8) {
+    //software scaler: whole frame in one pass, one texture upload
+    if ( config.renderer == RENDERER_SCALER) {
+        scaler_render(sdl.scaler, chip8 -> display) ;
+        SDL_UpdateTexture(sdl.texture, NULL, sdl.scaler -> pixels, sdl.scaler -> out_w * sizeof *sdl.scaler -> pixels) ;
+        SDL_RenderCopy(sdl.renderer, sdl.texture, NULL, NULL) ;
+        hud_draw(sdl.hud, sdl.renderer) ;
+        return ;
+    }
+
     SDL_Rect rect = {.x = 0 , .y = 0 , .w = config.scale_factor, .h = config.scale_factor} ;
 
     const uint8_t bg_r = (config.bg_color >> 24) & 0xFF ;
@@ -277,22 +286,102 @@ void update_screen(const sdl_t sdl , const config_t config , chip8_t *chip8) {
             SDL_RenderFillRect ( sdl.renderer , &rect) ;
         }
     }
+    hud_draw(sdl.hud, sdl.renderer) ;
+}
+
+//update screen after instructions have been processed each cycle
+void update_screen(const sdl_t sdl , const config_t config , chip8_t *chip8) {
+    render_screen(sdl, config, chip8) ;
     SDL_RenderPresent(sdl.renderer) ;
 }
 
 //update timers ( delay and sound )
 void update_timers ( chip8_t *chip8 , sdl_t sdl) {
-    if ( chip8 -> delay_timer > 0) chip8 -> delay_timer -- ;
+    const bool beep = chip8 -> sound_timer > 0 ;
+    tick_timers(chip8) ;
+
+    //hand a new XO-CHIP pattern or pitch to the callback, the filter is rebuilt here, not in the callback
+    xo_audio_t *xo = &sdl.audio -> xo_audio ;
+    if ( chip8 -> pattern_loaded && (!sdl.audio -> xo || chip8 -> pitch != xo -> pitch ||
+                                     memcmp(chip8 -> audio_pattern, xo -> pattern, sizeof xo -> pattern) != 0)) {
+        SDL_LockAudioDevice(sdl.audio_device_id) ;
+        xo_audio_set(xo, chip8 -> audio_pattern, chip8 -> pitch) ;
+        sdl.audio -> xo = true ;
+        SDL_UnlockAudioDevice(sdl.audio_device_id) ;
+    }
 
-    if ( chip8 -> sound_timer > 0) {
-        chip8 -> sound_timer -- ;
+    if ( beep) {
         // play sound
+        if ( !sdl.audio -> playing) {
+            SDL_LockAudioDevice(sdl.audio_device_id) ;
+            sdl.audio -> restart = true ;
+            SDL_UnlockAudioDevice(sdl.audio_device_id) ;
+        }
         SDL_PauseAudioDevice(sdl.audio_device_id, 0) ; //play 
     }
     else {
         //stop playing sound
         SDL_PauseAudioDevice(sdl.audio_device_id, 1) ;  //pause
     }
+    sdl.audio -> playing = beep ;
+}
+
+//setup frame pacing, the present period follows the host display when decoupled
+void init_pacer(pacer_t *pacer, const sdl_t sdl, const config_t config) {
+    const uint64_t freq = SDL_GetPerformanceFrequency() ;
+    pacer -> frame_ticks = freq / 60 ;
+    pacer -> present_ticks = pacer -> frame_ticks ;
+    pacer -> decoupled = config.host_refresh_render || config.vsync ;
+    pacer -> vsync_margin = freq / 1000 ;  //1ms for scheduler wakeup jitter
+
+    if ( pacer -> decoupled) {
+        SDL_DisplayMode mode ;
+        if ( SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(sdl.window), &mode) == 0 && mode.refresh_rate > 0)
+            pacer -> present_ticks = freq / mode.refresh_rate ;
+        else
+            SDL_Log("Could not get display refresh rate, presenting at 60Hz!!! %s\n", SDL_GetError()) ;
+    }
+
+    pacer -> next_frame = SDL_GetPerformanceCounter() ;
+    pacer -> next_present = pacer -> next_frame ;
+}
+
+//frame skipping: fixed (present 1 of N) or auto (drop presents that would miss the deadline)
+bool should_present(pacer_t *pacer, const config_t config, const uint64_t now) {
+    bool present ;
+    if ( config.frame_skip == 0) {
+        //auto: the present has to finish before the next emulated frame is due
+        present = now + pacer -> render_cost <= pacer -> next_frame || pacer -> skipped_in_row >= MAX_AUTO_SKIP ;
+    }
+    else {
+        present = pacer -> present_slots % config.frame_skip == 0 ;
+    }
+    pacer -> present_slots ++ ;
+
+    if ( present) pacer -> skipped_in_row = 0 ;
+    else pacer -> skipped_in_row ++ ;
+    return present ;
+}
+
+//latency probe: a CHIP8 key went down, timestamp from the SDL event
+void latency_press(latency_probe_t *probe, const uint32_t timestamp) {
+    if ( probe -> pending) return ; //still waiting on an earlier press
+    probe -> pending = true ;
+    probe -> pressed_ms = timestamp ;
+    probe -> presents = 0 ;
+}
+
+//latency probe: a frame showing display hash disp_hash was just presented
+void latency_presented(latency_probe_t *probe, metrics_t *metrics, const uint64_t disp_hash) {
+    if ( probe -> pending) {
+        if ( disp_hash != probe -> shown_hash) {
+            metrics_add(metrics, METRIC_LATENCY_SAMPLES, 1) ;
+            metrics_add(metrics, METRIC_LATENCY_MS, SDL_GetTicks() - probe -> pressed_ms) ;
+            probe -> pending = false ;
+        }
+        else if ( ++ probe -> presents >= LATENCY_GIVE_UP) probe -> pending = false ;
+    }
+    probe -> shown_hash = disp_hash ;
 }
 
 //to detect any input every time screeen refreshes
@@ -301,8 +390,9 @@ void update_timers ( chip8_t *chip8 , sdl_t sdl) {
 //456D                QWER
 //789E                ASDF
 //A0BF                ZXCV
-void handle_input(chip8_t *chip8) {
+void handle_input(chip8_t *chip8, const sdl_t sdl, debugger_t *debugger) {
     SDL_Event event ;
+    bool keypad_before[16] ;
 
     while ( SDL_PollEvent(&event)) {
 
@@ -314,6 +404,7 @@ void handle_input(chip8_t *chip8) {
                 break; 
 
             case SDL_KEYDOWN:
+                memcpy(keypad_before, chip8 -> keypad, sizeof keypad_before) ;
                 switch (event.key.keysym.sym) {
                     case SDLK_ESCAPE:
                         //Escape key quits
@@ -330,6 +421,15 @@ void handle_input(chip8_t *chip8) {
                             puts("Resumed!!!\n") ;
                         }
                         break ;
+                    case SDLK_BACKQUOTE:
+                        //` breaks into the debugger prompt on the console
+                        chip8 -> state = BREAK ;
+                        debugger_user_break(debugger) ;
+                        break ;
+                    case SDLK_F1:
+                        //F1 toggles the performance overlay
+                        sdl.hud -> visible = !sdl.hud -> visible ;
+                        break ;
                     
                     //map of qwerty to CHIP8 keypad
                     case SDLK_1: chip8 ->keypad[0x01] = true ; break;
@@ -354,6 +454,9 @@ void handle_input(chip8_t *chip8) {
                     
                     default: break;
                 }
+                //a CHIP8 key went down: start a latency measurement
+                if ( memcmp(keypad_before, chip8 -> keypad, sizeof keypad_before) != 0)
+                    latency_press(sdl.latency, event.key.timestamp) ;
                 break ;
 
             case SDL_KEYUP:  
@@ -388,480 +491,96 @@ void handle_input(chip8_t *chip8) {
     }
 }
 
-#ifdef DEBUG
-void print_debug_info( chip8_t *chip8, config_t config) {
-    // Emulate opcode
-    printf( "Address : 0x%04X, opcode: 0x%04X , Desc: ", chip8 -> PC -2 , chip8 -> inst.opcode) ;
-    switch ((chip8 ->inst.opcode >>12) & 0x0F) { //this is switch for D or the type/category of instruction that the machine has to currently execute
-        
-        case 0x0:
-            switch (chip8 -> inst.NN) {
-                case 0xE0 :
-                    //0x00E0: clear screen
-                    printf("Clear Screen\n") ;
-                    break;
-                case 0XEE :
-                    //0x00EE: return from subroutine (pop instruction from stack)
-                    printf("Return from subroutine to address 0x%04X\n",*(chip8 ->stack_top - 1) ) ;
-                    break ;
-                default:
-                    printf("Unimplemented opcode!!!\n") ;
-                    break;
-            }
-            break ;
-
-        case 0x01:
-            // 0x1NNN : jump(PC) to address NNN
-            printf( "jump to address NNN (0x%03X)\n", chip8 -> inst.NNN) ;
-            break ;
-
-        case 0x02:
-            //0x2NNN: call subroutine at NNN (push instruction to stack)
-            printf("Store address 0x%04X and jump to NNN (0x%03X)\n", *chip8 ->stack_top, chip8 -> inst.NNN) ;
-            break  ;
-
-        case 0x03:
-            //0x3XNN: skip next instruction if VX==NN
-            printf ( "If V%X == NN (0x%02X == 0x%02X), skip next instruction\n",chip8 -> inst.X , chip8 -> V[chip8 -> inst.X],chip8 -> inst.NN);
-            break ;
-
-        case 0x04:
-            //0x4XNN: skip next instruction if VX!=NN
-            printf ( "If V%X != NN (0x%02X != 0x%02X), skip next instruction\n",chip8 -> inst.X , chip8 -> V[chip8 -> inst.X],chip8 -> inst.NN);
-            break ;
-
-        case 0x05:
-            //0x5XY0: skip next instruction if VX==VY
-            if (chip8 -> inst.N != 0){
-                printf("Invalid opcode!!!\n"); //invalid opcode
-                break;
-            }
-            printf ( "If V%X == V%X  (0x%02X == 0x%02X), skip next instruction\n",chip8 -> inst.X ,chip8 -> inst.Y, chip8 -> V[chip8 -> inst.X],chip8 -> V[chip8 -> inst.Y]);
-            break ;
-
-        case 0x06:
-            //0x6NNN: Set register VX to NN
-            //basically put NN in register V[X]
-            printf( "Set V%X to NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN) ;
-            break;
-
-        case 0x07:
-            //0x7NNN: Add NN to VX
-            //basically V[X] += NN
-            printf( "Add: V%X += NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN) ;
-            break;
-
-        case 0x08: 
-            //0x8XYN:VX VY related ALU instructions
-            switch ( chip8 -> inst.N) {
-                case 0x0 :
-                    //Set VX = VY
-                    printf( "Set V%X (0x%02X) to V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break;
-                case 0x01 :
-                    //Set VX |= VY
-                    printf( "Set V%X (0x%02X) | = V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break ;
-                case 0x02 :
-                    //Set VX &= VY
-                    printf( "Set V%X (0x%02X) &= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break ;
-                case 0x03 :
-                    //Set VX ^= VY
-                    printf( "Set V%X (0x%02X) ^= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break ;
-                case 0x04 :
-                    //Set VX += VY, VF is for overflow, VF = 1 if carry
-                    printf( "Set V%X (0x%02X) += V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break ;
-                case 0x05 :
-                    //Set VX -= VY, VF is for underflow, VF = 0 if borrow
-                    printf( "Set V%X (0x%02X) -= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break;
-                case 0x06 :
-                    //Set VX >>= 1, VF is leftmost bit before shift
-                    printf( "Set V%X (0x%02X) >>= 1\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
-                    break;
-                case 0x07 :
-                    //Set VX = VY - VX, VF is for underflow, VF = 0 if borrow
-                    printf( "Set V%X (0x%02X) -= V%X (0x%02X), VX = - VX\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
-                    break;
-                case 0x0E :
-                    //Set VX >>= 1, VF is leftmost bit before shift
-                    printf( "Set V%X (0x%02X) <<= 1\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
-                    break;
-                default :
-                    printf("Invalid opcode!!!\n") ;
-                    break ; //invalid
-            }
-            break ;
+//run one emulated frame worth of instructions, reading input config.input_polls times:
+//once before the frame (main loop) and config.input_polls-1 times spread over the batch,
+//so FX0A and EX9E see a key pressed mid-frame
+//a display wait that lands exactly on the last instruction of a slice doesn't end the frame
+uint32_t run_frame(chip8_t *chip8, const config_t config, const sdl_t sdl, debugger_t *debugger) {
+    const uint32_t budget = config.clock_rate/60 ;
+    uint32_t executed = 0 ;
+
+    for ( uint32_t slice = 0 ; slice < config.input_polls ; slice ++) {
+        if ( slice > 0) {
+            handle_input(chip8, sdl, debugger) ;
+            if ( chip8 -> state != RUNNING) break ;
+        }
+        const uint32_t count = budget * (slice + 1) / config.input_polls - budget * slice / config.input_polls ;
 
-        case 0x09:
-            //0x9XY0: skip next instruction if VX!=VY
-            if (chip8 -> inst.N != 0){
-                printf("Invalid opcode!!!\n"); //invalid opcode
-                break;
-            }
-            printf ( "If V%X == V%X  (0x%02X != 0x%02X), skip next instruction\n",chip8 -> inst.X ,chip8 -> inst.Y, chip8 -> V[chip8 -> inst.X],chip8 -> V[chip8 -> inst.Y]);
-            break ;
-
-        case 0x0A:
-            // 0xANNN: Set index register to NNN
-            printf( "Set I to NNN (0x%03X)\n" , chip8 -> inst.NNN) ;
-            break;
-
-        case 0x0B:
-            // 0xBNNN: jump to V0 + NNN
-            printf( "jump to address V0 (0x%02X) + NNN (0x%03X)\n", chip8 -> V[0], chip8 -> inst.NNN) ;
-            break;
-
-        case 0x0C:
-            // 0xCXNN: Sets VX = rand(0,255) & NN 
-            printf( "Set V%X = rand() %% 256 & NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN ) ;
-            break ;
-
-        case 0x0D:
-            //0xDXYN: Draw sprite at coords VX,VY of height N
-            //sprite XORs the screen where drawn
-            //VF(carry flag) is set if any pixels are turned off, useful for collisions???
-            uint8_t X_coord = chip8 -> V[chip8 -> inst.X] % config.window_width;
-            uint8_t Y_coord = chip8 -> V[chip8 -> inst.Y] % config.window_height;
-            //const uint8_t original_X = X_coord ;
-            chip8 -> V[0xF] = 0 ; //initialize carry flag to 0???
-
-            printf ( "Display sprite at V%X,V%X (%u,%u) of height N (%u).\n" ,chip8 -> inst.X , chip8 -> inst.Y, X_coord, Y_coord,chip8 -> inst.N) ;
-
-            break;
-
-        case 0x0E:
-            //0xEXNN: key pressed if statements
-            switch (chip8 -> inst.NN) {
-                case 0x09E:
-                    //0xEX9E: if key stored in VX is pressed, skip instruction
-                    printf ( "If key stored in V%X (0x%02X) is pressed, skip next instruction\n", chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
-                    break ;
-                case 0x0A1:
-                    //0xEXA1: if key stored in VX is not pressed, skip instruction
-                    printf ( "If key stored in V%X (0x%02X) is not pressed, skip next instruction\n", chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
-                    break ;
-                default:
-                    printf("Invalid opcode!!!\n") ;
-                    break ; //invalid
-            }
-            break ;
-
-        case 0x0F:
-            //0xFXNN: misc with register VX
-            switch ( chip8 -> inst.NN) {
-                case 0x07 :
-                    //0xVX07: sets VX to delay timer
-                    printf("Sets V%X = delay timer (0x%02X)\n", chip8 -> inst.X , chip8 -> delay_timer ) ;
-                    break ;
-                case 0x0A :
-                    //0xVX07: await for a keypress, then store first keypress in VX
-                    printf( "Wait till key pree, store at V%X\n", chip8 -> inst.X ) ;
-                    break ;
-                case 0x15 :
-                    //0xFX15: Set delay timer to VX
-                    printf( "Set delay timer to V%X (0x%02X)\n",chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
-                    break ;    
-                case 0x18 :
-                    //0xFX15: Set sound timer to VX
-                    printf( "Set sound timer to V%X (0x%02X)\n",chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
-                    break ;
-                case 0x1E :
-                    //0xFX15: Set I += VX
-                    printf("Set I (0x%04X) += V%X (0x%02X)\n",chip8 -> I,chip8 -> inst.X,chip8 -> V[chip8 -> inst.X] ) ;
-                    break ;  
-                case 0x29 :
-                    //0xFX29: Set I to location of sprite/font of char stored in VX(0x0-0xF) from RAM
-                    if ((chip8 -> V[chip8 -> inst.X]) > 0xF) {
-                        printf("VX stores value > F\n") ;
-                        break ; //font not availible
-                    }
-                    printf( "Set I to the sprite location in V%X (0x%02X)\n", chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
-                    break;
-                case 0x33 :
-                    //0xFX33: Store BCD(VX(0-255)) at location I,I+1,I+2; eg. if VX=205 and I=5 then ram[5]=2,ram[6]=0 ,ram[7]=5
-                    printf("Store BCD at V%X (0x%02X) in RAM starting from location I (0x%04X)\n", chip8 -> inst.X,chip8 -> V[chip8 -> inst.X], chip8 -> I) ;
-                    break;    
-                case 0x55 :
-                    //0xFX55: Dump V0 to VX in ram starting from indesx stored at I, basically ram[I]=V0, ram[I+1]=V1 ...ram[I+X] = V[x]
-                    printf( "Dump V0 to V%X into RAM starting from location I (0x%04X)\n", chip8 -> inst.X,  chip8 -> I) ;
-                    break;
-                case 0x65 :
-                    //0xFX65: Load registers V0 to VX with ram[I] to ram[I+X], opposite of above
-                    printf( "Load V0 to V%X from RAM starting from location I (0x%04X)\n", chip8 -> inst.X,  chip8 -> I) ;
-                    break;
-                default :
-                    break ; //invalid
-            }
-            break ;
+        //the instrumented loop only runs while the debugger has something armed
+        uint32_t ran ;
+        if ( debugger -> armed) {
+            ran = run_instructions_debug(chip8 , config , debugger , count) ;
+            if ( debugger -> reason != BREAK_NONE) chip8 -> state = BREAK ;
+        }
+        else ran = run_instructions(chip8 , config , count) ;
 
-        default :
-            printf("Unimplemented opcode!!!\n") ;
-            break; //for invalid/unimplemented instructions
+        executed += ran ;
+        if ( ran < count || chip8 -> state != RUNNING) break ; //display wait ended the frame, or a breakpoint hit
     }
+    return executed ;
 }
 
+//run config.headless_frames frames flat out, no window or audio, one line per frame:
+//number, chained hash of every frame so far, hash of this frame's state
+//two builds or runs of a ROM diverge at the first frame whose chained hashes differ,
+//the state hash can match again later (a differing byte gets overwritten)
+void run_headless(chip8_t *chip8, const config_t config) {
+    chip8 -> rng = xorshift_seed(config.rng_seed ? config.rng_seed : 1) ; //CXNN must replay identically
+    uint64_t chain = chip8_hash_chain(0, chip8) ;
+    printf("frame 0 %016" PRIx64 " %016" PRIx64 "\n", chain, chip8_hash(chip8)) ;
+    for ( uint32_t frame = 1 ; frame <= config.headless_frames ; frame ++) {
+        run_instructions(chip8 , config , config.clock_rate/60) ;
+        tick_timers(chip8) ;
+        chain = chip8_hash_chain(chain, chip8) ;
+        printf("frame %u %016" PRIx64 " %016" PRIx64 "\n", frame, chain, chip8_hash(chip8)) ;
+    }
+}
 
-#endif
-
-//emulate 1 CHIP8 instruction
-void emulate_instruction(chip8_t *chip8 , const config_t config) {
-    //get opcode/instruction from PC which points to opcode to be executed in the ram
-    chip8 -> inst.opcode = chip8->ram[chip8->PC] << 8 | chip8->ram[chip8->PC + 1] ;
-    chip8 -> PC += 2 ;  //increment the PC before itself for location of next opcode
-
-    //format DXYN
-    //update current instruction codes: N,NN,NN...
-    chip8 ->inst.NNN = chip8 -> inst.opcode & 0x0FFF ;
-    chip8 ->inst.NN = chip8 -> inst.opcode & 0x0FF ;
-    chip8 ->inst.N = chip8 -> inst.opcode & 0x0F ;
-    chip8 ->inst.X = (chip8 -> inst.opcode >>8) & 0x0F ;
-    chip8 ->inst.Y = (chip8 -> inst.opcode >>4) & 0x0F ;
-
-#ifdef DEBUG
-print_debug_info(chip8, config) ;
-#endif
-
-    // Emulate opcode
-    switch ((chip8 ->inst.opcode >>12) & 0x0F) { //this is switch for D or the type/category of instruction that the machine has to currently execute
-        
-        case 0x0:
-            switch (chip8 -> inst.NN) {
-                case 0xE0 :
-                    //0x00E0: clear screen
-                    memset(&chip8 -> display[0] , false, sizeof ( chip8 -> display ) ) ;
-                    break ;
-                case 0XEE :
-                    //0x00EE: return from subroutine (pop instruction from stack)
-                    chip8 -> PC = *--chip8 -> stack_top ;
-                    break ;
-                default:
-                    break;
-            }
-            break ;
-
-        case 0x01:
-            // 0x1NNN : jump(PC) to address NNN
-            chip8 -> PC = chip8 -> inst.NNN ;
-            break ;
-
-        case 0x02:
-            //0x2NNN: call subroutine at NNN (push instruction to stack)
-            *chip8 -> stack_top ++ = chip8 -> PC ; // save current address of instruction to stack (for returning back to it later)
-            chip8 -> PC = chip8 -> inst.NNN ; // make PC point to address of subroutine which will be next instruction
-            break ;
-
-        case 0x03:
-            //0x3XNN: skip next instruction if VX==NN
-            if ( chip8 -> V[chip8 ->inst.X] == chip8 ->inst.NN) chip8 -> PC += 2 ;
-            break ;
-
-        case 0x04:
-            //0x4XNN: skip next instruction if VX!=NN
-            if ( chip8 -> V[chip8 ->inst.X] != chip8 ->inst.NN) chip8 -> PC += 2 ;
-            break ;
-
-        case 0x05:
-            //0x5XY0: skip next instruction if VX==VY
-            if (chip8 -> inst.N != 0) break; //invalid opcode
-            if ( chip8 -> V[chip8 ->inst.X] == chip8 -> V[chip8 ->inst.Y]) chip8 -> PC += 2 ;
-            break ;
-
-        case 0x06:
-            //0x6NNN: Set register VX to NN
-            //basically put NN in register V[X]
-            chip8 -> V[chip8 ->inst.X] = chip8 ->inst.NN ;
-            break;
-
-        case 0x07:
-            //0x7NNN: Add NN to VX
-            //basically V[X] += NN
-            chip8 -> V[chip8 ->inst.X] += chip8 ->inst.NN ;
-            break;
-
-        case 0x08: 
-            //0x8XYN:VX VY related ALU instructions
-            switch ( chip8 -> inst.N) {
-                case 0x0 :
-                    //Set VX = VY
-                    chip8 -> V[chip8 -> inst.X] = chip8 -> V[chip8 -> inst.Y] ;
-                    break;
-                case 0x01 :
-                    //Set VX |= VY
-                    chip8 -> V[chip8 -> inst.X] |= chip8 -> V[chip8 -> inst.Y] ;
-                    break ;
-                case 0x02 :
-                    //Set VX &= VY
-                    chip8 -> V[chip8 -> inst.X] &= chip8 -> V[chip8 -> inst.Y] ;
-                    break ;
-                case 0x03 :
-                    //Set VX ^= VY
-                    chip8 -> V[chip8 -> inst.X] ^= chip8 -> V[chip8 -> inst.Y] ;
-                    break ;
-                case 0x04 :
-                    //Set VX += VY, VF is for overflow, VF = 1 if carry
-                    if ((uint16_t)chip8 -> V[chip8 -> inst.X] + chip8 -> V[chip8 -> inst.Y] > 255 )  chip8 -> V[0x0F] = 0x01;
-                    else chip8 -> V[0x0F] = 0x0;
-                    chip8 -> V[chip8 -> inst.X] += chip8 -> V[chip8 -> inst.Y] ;
-                    break ;
-                case 0x05 :
-                    //Set VX -= VY, VF is for underflow, VF = 0 if borrow
-                    if (chip8 -> V[chip8 -> inst.X] < chip8 -> V[chip8 -> inst.Y]  )  chip8 -> V[0x0F] = 0x0;
-                    else chip8 -> V[0x0F] = 0x01;
-                    chip8 -> V[chip8 -> inst.X] -= chip8 -> V[chip8 -> inst.Y] ;
-                    break;
-                case 0x06 :
-                    //Set VX >>= 1, VF is leftmost bit before shift
-                    chip8 -> V[0x0F] = chip8 -> V[chip8 -> inst.X] & (0x01) ;
-                    chip8 -> V[chip8 -> inst.X] >>= 1 ;
-                    break;
-                case 0x07 :
-                    //Set VX = VY - VX, VF is for underflow, VF = 0 if borrow
-                    if (chip8 -> V[chip8 -> inst.X] > chip8 -> V[chip8 -> inst.Y]  )  chip8 -> V[0x0F] = 0x0;
-                    else chip8 -> V[0x0F] = 0x01;
-                    chip8 -> V[chip8 -> inst.X] = chip8 -> V[chip8 -> inst.Y] - chip8 -> V[chip8 -> inst.X] ;
-                    break;
-                case 0x0E :
-                    //Set VX >>= 1, VF is leftmost bit before shift
-                    chip8 -> V[0x0F] = chip8 -> V[chip8 -> inst.X] >> 7 ;
-                    chip8 -> V[chip8 -> inst.X] <<= 1 ;
-                    break;
-                default :
-                    break ; //invalid
-            }
-            break ;
-
-        case 0x09:
-            //0x9XY0: skip next instruction if VX!=VY
-            if (chip8 -> inst.N != 0) break; //invalid opcode
-            if ( chip8 -> V[chip8 ->inst.X] != chip8 -> V[chip8 ->inst.Y]) chip8 -> PC += 2 ;
-            break ;
-
-        case 0x0A:
-            // 0xANNN: Set index register to NNN
-            chip8 -> I = chip8 -> inst.NNN ;
-            break;
-
-        case 0x0B:
-            // 0xBNNN: jump to V0 + NNN
-            chip8 -> PC = chip8 -> inst.NNN  + chip8 -> V[0];
-            break;
-
-        case 0x0C:
-            // 0xCXNN: Sets VX = rand(0,255) & NN 
-            chip8 -> V[ chip8 -> inst.X ] = (rand() % 256) & chip8-> inst.NN ;
-            break ;
-
-        case 0x0D:
-            //0xDXYN: Draw sprite at coords VX,VY of height N
-            //sprite XORs the screen where drawn
-            //VF(carry flag) is set if any pixels are turned off, useful for collisions???
-            uint8_t X_coord = chip8 -> V[chip8 -> inst.X] % config.window_width;
-            uint8_t Y_coord = chip8 -> V[chip8 -> inst.Y] % config.window_height;
-            const uint8_t original_X = X_coord ;
-            chip8 -> V[0xF] = 0 ; //initialize carry flag to 0???
-
-            //loop for N rows
-            for ( uint8_t i = 0 ; i < chip8 -> inst.N ; i ++) {
-                X_coord = original_X ; // reset X
-                const uint8_t sprite_data = chip8 -> ram[chip8 -> I + i] ; //I is address of sprite data, i is offset(each sprite is 1 byte wide)
-
-                for ( int j = 7 ; j >= 0 ; j --) {
-                    bool *pixel = &chip8 -> display[Y_coord*config.window_width + X_coord] ;
-                    const bool sprite_bit = ((sprite_data>>j)&1) ;
-
-                    if ( sprite_bit && *pixel) chip8 -> V[0x0F] = 1 ; // carry flag condition
-                    *pixel ^= sprite_bit ; // XOR pixel with data
-
-                    if ( ++X_coord >= config.window_width) break ;  // right edge case
-                }
+//switch the running emulator over to a reloaded configuration, the machine itself is untouched
+//window, renderer, scaler and audio device are only rebuilt when a setting they depend on changed
+void apply_config(sdl_t *sdl, config_t *config, const config_t *fresh, pacer_t *pacer) {
+    const config_t old = *config ;
+
+    //the audio callback reads the config too, the XO-CHIP mixer keeps its own copy of the volume
+    SDL_LockAudioDevice(sdl -> audio_device_id) ;
+    *config = *fresh ;
+    sdl -> audio -> xo_audio.volume = config -> volume ;
+    SDL_UnlockAudioDevice(sdl -> audio_device_id) ;
+
+    //startup only: the debugger and CXNN seed were set up before the first frame
+    config -> start_in_debugger = old.start_in_debugger ;
+    config -> rng_seed = old.rng_seed ;
+
+    if ( config -> scale_factor != old.scale_factor)
+        SDL_SetWindowSize(sdl -> window, config -> window_width * config -> scale_factor, config -> window_height * config -> scale_factor) ;
+
+    if ( config -> vsync != old.vsync && SDL_RenderSetVSync(sdl -> renderer, config -> vsync) != 0)
+        SDL_Log("Could not switch vsync!!! %s\n", SDL_GetError()) ;
+
+    //the scaler bakes size, outlines, scanlines and decay into its tables
+    if ( config -> renderer != old.renderer || config -> scale_factor != old.scale_factor ||
+         config -> pixel_outlines != old.pixel_outlines || config -> scanlines != old.scanlines ||
+         config -> phosphor_decay != old.phosphor_decay) {
+        free_scaler(sdl) ;
+        if ( !init_scaler(sdl, config)) {
+            SDL_Log("Falling back to the rects renderer\n") ;
+            free_scaler(sdl) ;
+            config -> renderer = RENDERER_RECTS ;
+        }
+    }
 
-                if ( ++Y_coord >= config.window_height) break ;  // bottom edge case
-            }
+    if ( config -> audio_sample_rate != old.audio_sample_rate || config -> audio_buffer != old.audio_buffer) {
+        SDL_CloseAudioDevice(sdl -> audio_device_id) ;
+        if ( !open_audio(sdl, config)) SDL_Log("Continuing without sound\n") ;
+    }
 
-            break;
-
-        case 0x0E:
-            //0xEXNN: key pressed if statements
-            switch (chip8 -> inst.NN) {
-                case 0x09E:
-                    //0xEX9E: if key stored in VX is pressed, skip instruction
-                    if (chip8 ->keypad[chip8 ->V[chip8 ->inst.X]]) chip8 -> PC += 2 ;
-                    break ;
-                case 0x0A1:
-                    //0xEXA1: if key stored in VX is not pressed, skip instruction
-                    if (!chip8 ->keypad[chip8 ->V[chip8 ->inst.X]]) chip8 -> PC += 2 ;
-                    break ;
-                default:
-                    break ; //invalid
-            }
-            break ;
-
-        case 0x0F:
-            //0xFXNN: misc with register VX
-            switch ( chip8 -> inst.NN) {
-                case 0x07 :
-                    //0xVX07: sets VX to delay timer
-                    chip8 -> V[chip8 -> inst.X] = chip8 -> delay_timer ;
-                    break ;
-                case 0x0A :
-                    //0xVX07: await for a keypress, then store first keypress in VX
-                    bool flag = true ;
-                    for ( uint8_t i = 0 ; i < sizeof chip8 ->keypad ; i ++) {
-                        if (chip8 -> keypad[i]) {
-                            chip8 -> V[chip8 -> inst.X] = i ;
-                            flag = false;
-                            break ;
-                        }
-                    }
-                    if ( flag ) chip8 -> PC -= 2 ; //repeat instruction if no key pressed
-                    break ;
-                case 0x15 :
-                    //0xFX15: Set delay timer to VX
-                    chip8 -> delay_timer = chip8 -> V[chip8 -> inst.X] ;
-                    break ;    
-                case 0x18 :
-                    //0xFX15: Set sound timer to VX
-                    chip8 -> sound_timer = chip8 -> V[chip8 -> inst.X] ;
-                    break ;
-                case 0x1E :
-                    //0xFX15: Set I += VX
-                    chip8 -> I += chip8 -> V[chip8 -> inst.X] ;
-                    break ;  
-                case 0x29 :
-                    //0xFX29: Set I to location of sprite/font of char stored in VX(0x0-0xF) from RAM
-                    if ((chip8 -> V[chip8 -> inst.X]) > 0xF) break ; //font not availible
-                    chip8 -> I = (chip8 -> V[chip8 -> inst.X]) * 5 ;
-                    break;
-                case 0x33 :
-                    //0xFX33: Store BCD(VX(0-255)) at location I,I+1,I+2; eg. if VX=205 and I=5 then ram[5]=2,ram[6]=0 ,ram[7]=5
-                    chip8 -> ram[chip8 -> I + 2] = (chip8 -> V[chip8 -> inst.X]) % 10 ;           //ones digit store in ram[I]
-                    chip8 -> ram[chip8 -> I + 1] = ((chip8 -> V[chip8 -> inst.X])/10) % 10 ;  //tens digit store in ram[I+1]
-                    chip8 -> ram[chip8 -> I ] = ((chip8 -> V[chip8 -> inst.X])/100) % 10 ; //hundereds digit store in ram[I+2]
-                    break;    
-                case 0x55 :
-                    //0xFX55: Dump V0 to VX in ram starting from indesx stored at I, basically ram[I]=V0, ram[I+1]=V1 ...ram[I+X] = V[x]
-                    for ( uint8_t i = 0; i <= chip8 -> inst.X ; i ++) {
-                        chip8 -> ram[chip8 -> I + i] = chip8 -> V[i] ; //dump sequentially
-                    }
-                    break;
-                case 0x65 :
-                    //0xFX65: Load registers V0 to VX with ram[I] to ram[I+X], opposite of above
-                    for ( uint8_t i = 0; i <= chip8 -> inst.X ; i ++) {
-                        chip8 -> V[i] = chip8 -> ram[chip8 -> I + i]  ; //load sequentially
-                    }
-                    break;
-                default :
-                    break ; //invalid
-            }
-            break ;
+    if ( config -> show_hud != old.show_hud) sdl -> hud -> visible = config -> show_hud ;
 
-        default :
-            break; //for invalid/unimplemented instructions
-    }
+    if ( config -> vsync != old.vsync || config -> host_refresh_render != old.host_refresh_render)
+        init_pacer(pacer, *sdl, *config) ;
+
+    //clock rate, frame skip, input polls, quirks and the metrics file are read every frame
+    SDL_Log("Reloaded %s\n", config -> config_path) ;
 }
 
 //mainmain 
@@ -870,13 +589,21 @@ int main( int argc, char **argv) {
 
     //Default message for displaying all args
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <rom_name>\n", argv[0]) ;
+        fprintf(stderr, "Usage: %s <rom_name> [--frame-skip <n|auto>] [--host-refresh] [--vsync] [--input-polls <n>] [--renderer <scaler|rects>] [--no-outlines] [--scanlines] [--phosphor <0-255>] [--quirks <modern|vip|schip|xochip>] [--debug] [--headless <frames>] [--seed <n>] [--hud] [--metrics <file>] [--clock <hz>] [--scale <n>] [--audio-rate <hz>] [--audio-buffer <samples>] [--config <file>]\n", argv[0]) ;
         exit( EXIT_FAILURE) ;
     }
 
     //Initialize emulator configuration/options
     config_t config = {0} ;
-    if (!set_config(&config, argc, argv)) exit(EXIT_FAILURE) ;
+    if (!config_init(&config, argc, argv)) exit(EXIT_FAILURE) ;
+
+    //headless run skips SDL entirely
+    if ( config.headless_frames) {
+        chip8_t chip8 = {0} ;
+        if ( !init_chip8(&chip8 , argv[1])) exit(EXIT_FAILURE) ;
+        run_headless(&chip8, config) ;
+        exit(EXIT_SUCCESS) ;
+    }
 
     // Initialize SDL
     sdl_t sdl = {0} ;
@@ -891,40 +618,133 @@ int main( int argc, char **argv) {
     clear_screen(sdl,config) ;
 
     //seed random
-    srand(time(NULL)) ;
+    chip8.rng = xorshift_seed(config.rng_seed ? config.rng_seed : (uint32_t)time(NULL)) ;
+
+    //debugger, disarmed until breakpoints or watches are set at its prompt
+    debugger_t debugger ;
+    debugger_init(&debugger) ;
+    if ( config.start_in_debugger) {
+        chip8.state = BREAK ;
+        debugger_user_break(&debugger) ;
+    }
+
+    //frame pacing
+    pacer_t pacer = {0} ;
+    init_pacer(&pacer, sdl, config) ;
+
+    //overlay and metrics file are refreshed once a second from counter snapshots
+    const uint64_t ticks_per_second = SDL_GetPerformanceFrequency() ;
+    metrics_snapshot_t last_snapshot ;
+    metrics_snapshot(sdl.metrics, SDL_GetPerformanceCounter(), &last_snapshot) ;
+
+    //config file changes apply to the running machine
+    config_watch_t watch ;
+    const bool watching = config.config_path[0] && config_watch_init(&watch, config.config_path) ;
 
     //main emulator loop
     while (chip8.state != QUIT) {
         //handle user input
-        handle_input(&chip8) ;
+        handle_input(&chip8, sdl, &debugger) ;
+
+        if ( watching && config_watch_changed(&watch)) {
+            config_t fresh ;
+            if ( config_init(&fresh, argc, argv)) apply_config(&sdl, &config, &fresh, &pacer) ;
+            else SDL_Log("Config file %s has errors, keeping the running configuration\n", config.config_path) ;
+        }
 
         if (chip8.state == PAUSED) continue ;
 
-        //Get time before instructions
-        const uint64_t start_time = SDL_GetPerformanceCounter() ;
+        if (chip8.state == BREAK) {
+            //show the machine as it is, then block on the console prompt
+            update_screen(sdl , config , &chip8) ;
+            SDL_PauseAudioDevice(sdl.audio_device_id, 1) ;
+            chip8.state = debugger_prompt(&debugger , &chip8 , config) ;
+            pacer.next_frame = pacer.next_present = SDL_GetPerformanceCounter() ; //time spent at the prompt isn't emulation time
+            continue ;
+        }
 
-        //Emulate chip8 instructions
-        for (uint32_t i = 0 ; i < config.clock_rate/60 ; i ++)
-            emulate_instruction(&chip8 , config) ;
+        uint64_t now = SDL_GetPerformanceCounter() ;
 
-        //Get time after instructions
-        const uint64_t end_time = SDL_GetPerformanceCounter() ;
+        //emulation, timers and audio always run at the full 60Hz rate
+        bool new_frame = false ;
+        if ( now >= pacer.next_frame) {
+            //Emulate chip8 instructions, a display wait may end the frame early
+            const uint32_t executed = run_frame(&chip8 , config , sdl , &debugger) ;
 
-        //tiime elapsed in ms(from SDL docs)
-        const double time_elapsed = (double)((end_time - start_time)*1000) / SDL_GetPerformanceFrequency() ;
+            //update delay and sound timers
+            update_timers(&chip8, sdl) ;
 
-        //Delay for 60 fps ~ 16.67
-        SDL_Delay(16.67f > time_elapsed ? 16.67f - time_elapsed : 0) ;
+            metrics_add(sdl.metrics, METRIC_INSTRUCTIONS, executed) ;
+            metrics_add(sdl.metrics, METRIC_FRAMES, 1) ;
+            if ( sdl.scaler) scaler_tick(sdl.scaler) ;
+            metrics_add(sdl.metrics, METRIC_EMU_TICKS, SDL_GetPerformanceCounter() - now) ;
 
-        // Update window with changes
-        update_screen(sdl , config , &chip8) ;
+            pacer.next_frame += pacer.frame_ticks ;
+            if ( now > pacer.next_frame + MAX_AUTO_SKIP*pacer.frame_ticks) pacer.next_frame = now ; //way behind (paused, window dragged), don't try to catch up
+            new_frame = true ;
+        }
 
-        //update delay and sound timers
-        update_timers(&chip8, sdl) ;
+        //a present is due once per emulated frame, or on every host refresh when decoupled
+        bool present_due = new_frame ;
+        if ( pacer.decoupled) {
+            present_due = now >= pacer.next_present ;
+            if ( present_due) {
+                pacer.next_present += pacer.present_ticks ;
+                if ( now > pacer.next_present) pacer.next_present = now + pacer.present_ticks ;
+            }
+        }
+
+        //once a second: new overlay text and metrics file
+        if ( now - last_snapshot.ticks >= ticks_per_second) {
+            metrics_snapshot_t snapshot ;
+            metrics_rates_t rates ;
+            metrics_snapshot(sdl.metrics, now, &snapshot) ;
+            metrics_rates(&last_snapshot, &snapshot, ticks_per_second, &rates) ;
+            hud_update(sdl.hud, &rates) ;
+            if ( config.metrics_path[0] && !metrics_write(&snapshot, ticks_per_second, config.metrics_path))
+                SDL_Log("Could not write metrics to %s\n", config.metrics_path) ;
+            last_snapshot = snapshot ;
+        }
+
+        // Update window with changes, right after emulation so the frame shows this frame's input
+        if ( present_due) {
+            //read the clock again: auto skip has to count the time emulating this frame already took
+            if ( should_present(&pacer, config, SDL_GetPerformanceCounter())) {
+                const uint64_t render_start = SDL_GetPerformanceCounter() ;
+                render_screen(sdl , config , &chip8) ;
+                const uint64_t render_end = SDL_GetPerformanceCounter() ;
+                SDL_RenderPresent(sdl.renderer) ;
+                const uint64_t presented = SDL_GetPerformanceCounter() ;
+
+                pacer.render_cost = (pacer.render_cost*7 + (render_end - render_start)) / 8 ;
+                metrics_add(sdl.metrics, METRIC_PRESENTS, 1) ;
+                metrics_add(sdl.metrics, METRIC_RENDER_TICKS, render_end - render_start) ;
+                latency_presented(sdl.latency, sdl.metrics, chip8.disp_hash) ;
+
+                //the present returned at a vblank: wake for the next one just in time to render for it,
+                //the time blocked in the present was spent waiting like a sleep
+                if ( config.vsync) {
+                    const uint64_t lead = pacer.render_cost + pacer.vsync_margin ;
+                    pacer.next_present = presented + (pacer.present_ticks > lead ? pacer.present_ticks - lead : 0) ;
+                    metrics_add(sdl.metrics, METRIC_SLEEP_TICKS, presented - render_end) ;
+                }
+            }
+            else metrics_add(sdl.metrics, METRIC_DROPPED, 1) ;
+        }
+
+        //sleep until the next frame or present is due
+        now = SDL_GetPerformanceCounter() ;
+        uint64_t wake = pacer.next_frame ;
+        if ( pacer.decoupled && pacer.next_present < wake) wake = pacer.next_present ;
+        if ( wake > now) {
+            SDL_Delay((uint32_t)((wake - now) * 1000 / ticks_per_second)) ;
+            metrics_add(sdl.metrics, METRIC_SLEEP_TICKS, SDL_GetPerformanceCounter() - now) ;
+        }
     }
 
 
     //Final cleanup
+    if ( watching) config_watch_free(&watch) ;
     final_cleanup(sdl) ;
     
     
@@ -0,0 +1,187 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//core CHIP8 machine, shared by the SDL frontend and the batch engine
+//nothing in here may depend on SDL
+
+//how update_screen() draws
+typedef enum {
+    RENDERER_SCALER ,  //software scaler, one texture upload per frame
+    RENDERER_RECTS ,   //one SDL_RenderFillRect per CHIP8 pixel
+} renderer_t ;
+
+//interpreter variants, each one is a separately compiled instantiation of the hot loop
+typedef enum {
+    PROFILE_MODERN ,   //what this emulator always did
+    PROFILE_VIP ,      //COSMAC VIP
+    PROFILE_SCHIP ,    //SUPER-CHIP 1.1
+    PROFILE_XOCHIP ,   //XO-CHIP
+    PROFILE_COUNT ,
+} quirk_profile_t ;
+
+//behavior of one profile, see the QUIRKS_* lists below
+typedef struct {
+    bool shift_vy ;    //8XY6/8XYE shift VY into VX instead of shifting VX
+    bool mem_inc_i ;   //FX55/FX65 leave I = I + X + 1
+    bool jump_vx ;     //BNNN is BXNN: jump to XNN + VX
+    bool vf_reset ;    //8XY1/8XY2/8XY3 reset VF to 0
+    bool wrap ;        //DXYN wraps sprites around the screen edges instead of clipping
+    bool disp_wait ;   //DXYN waits for the next 60Hz frame
+    bool xo_audio ;    //F002 loads the audio pattern, FX3A sets its pitch
+} quirks_t ;
+
+//quirk values per profile, in quirks_t field order
+//these are plain token lists so chip8_exec.inc and chip8_lockstep.inc can fold them at compile time
+#define QUIRKS_MODERN  0, 0, 0, 0, 0, 0, 0
+#define QUIRKS_VIP     1, 1, 0, 1, 0, 1, 0
+#define QUIRKS_SCHIP   0, 0, 1, 0, 0, 0, 0
+#define QUIRKS_XOCHIP  1, 1, 0, 0, 1, 0, 1
+
+//EX_QUIRK(NAME) picks one quirk out of the list a template includer defined as EX_QUIRKS, the result is a literal 0 or 1
+#define EX_QUIRK_SHIFT_VY_(a, b, c, d, e, f, g)  a
+#define EX_QUIRK_MEM_INC_I_(a, b, c, d, e, f, g) b
+#define EX_QUIRK_JUMP_VX_(a, b, c, d, e, f, g)   c
+#define EX_QUIRK_VF_RESET_(a, b, c, d, e, f, g)  d
+#define EX_QUIRK_WRAP_(a, b, c, d, e, f, g)      e
+#define EX_QUIRK_DISP_WAIT_(a, b, c, d, e, f, g) f
+#define EX_QUIRK_XO_AUDIO_(a, b, c, d, e, f, g)  g
+#define EX_QUIRK_(sel, ...) sel(__VA_ARGS__)
+#define EX_QUIRK(name) EX_QUIRK_(EX_QUIRK_##name##_, EX_QUIRKS)
+
+extern const quirks_t quirk_table[PROFILE_COUNT] ;
+
+#define CONFIG_PATH_MAX 256
+
+//configuration, filled in by config.c
+typedef struct {
+    uint32_t window_width;
+    uint32_t window_height ;
+    uint32_t fg_color ; //foreground RGBA
+    uint32_t bg_color ; //background RGBA
+    uint32_t scale_factor; //number of windows pixels one chip8 pixel will be
+    bool pixel_outlines ;
+    uint32_t clock_rate ; //instructions per second
+    uint32_t square_freq;  //frequency of square wave to be played
+    uint32_t audio_sample_rate ;
+    uint16_t audio_buffer ;  //samples per audio callback, smaller is lower latency but underruns sooner
+    uint16_t volume;       //volume
+    uint32_t frame_skip ;  //present 1 of every frame_skip frames, 0 = auto (drop presents that would miss the frame deadline)
+    bool host_refresh_render ; //present at the host display refresh rate instead of once per emulated frame
+    bool vsync ;           //presents wait for the vertical blank, implies presenting at the host refresh rate
+    uint32_t input_polls ; //input is read this many times per emulated frame, spread over the instruction batch
+    renderer_t renderer ;  //scaler or SDL rects
+    bool scanlines ;       //CRT style scanlines (scaler only)
+    uint8_t phosphor_decay ; //phosphor persistence per emulated frame, 0 = off (scaler only)
+    quirk_profile_t quirks ; //interpreter variant
+    bool start_in_debugger ; //stop at the debugger prompt before the first instruction
+    uint32_t headless_frames ; //run this many frames without a window, printing the state hash of each, 0 = normal run
+    uint32_t rng_seed ;    //seed for CXNN, 0 = from the clock (headless runs use 1 so they are reproducible)
+    char metrics_path[CONFIG_PATH_MAX] ; //counters written here every second for the dashboards, empty = off
+    bool show_hud ;        //start with the performance overlay on, F1 toggles it
+    char config_path[CONFIG_PATH_MAX] ; //config file, reloaded when it changes, empty = none
+} config_t ;
+
+//states of emulator
+typedef enum {
+    QUIT ,
+    RUNNING,
+    PAUSED,
+    BREAK ,   //stopped in the debugger
+} emulator_state_t ;
+
+//chip8 instruction format
+typedef struct {
+    //instruction: format DXYN
+    // 4*4=16 bits or 4 hex , that is 4 bits for each letter
+    //D is the instruction type or category(directly implemented while emulating in form of switch case)
+    //note all of these can directly be implemented while emulating, but cmon
+
+    uint16_t opcode ;  //the whole instruction is called opcode
+    uint16_t NNN ;     //12 bit  adress/constant (rightmost 12 bits of opcode)
+    uint8_t NN ;       //8 bit constant (rightmost 8 bits of opcode)
+    uint8_t N ;        //4 bit constant (rightmost 4 bits of opcode)
+    uint8_t X ;        //4 bit register identifier (5th to 8th bit from right)
+    uint8_t Y ;        //4 bit register identifier (9th to 12th bit from right)
+
+} instruction_t ;
+
+#define STACK_DEPTH 12    //entries in the subroutine stack, the batch and fork machines use the same depth
+
+//CHIP8 machine
+typedef struct {
+    emulator_state_t state;
+    uint8_t ram[4096] ;      //RAM
+    bool display[64*32] ;     // original CHIP8 resolution
+    uint16_t stack[STACK_DEPTH] ;      //stack for subroutines(instructions inside instructions, the stack probably stores the addreess of the parent instructions that we have to come back to)
+    uint16_t *stack_top ;      //pointer to top of stack
+    uint8_t V[16] ;           //data registers from V0 to VF(to actually store temporary data)
+    uint16_t I ;              //Index register, register to store indices/locations in memory
+    uint16_t PC;              //program counter, stores address of instruction excecuted
+    uint8_t delay_timer;      //records delay, executes instruction when>0
+    uint8_t sound_timer;      //plays sound when >0
+    bool keypad[16] ;         //hexadecimal keypad
+    const char *rom_name;     //currently running ROM
+    instruction_t inst;       //currently executing instruction
+    uint64_t ram_hash ;       //incremental hash of ram (chip8_hash.h), updated by every write
+    uint64_t disp_hash ;      //incremental hash of display, updated by every pixel flip
+    uint8_t audio_pattern[16] ; //XO-CHIP 1 bit audio samples, loaded by F002
+    uint8_t pitch ;           //XO-CHIP playback rate of the pattern, set by FX3A, 64 = 4000Hz
+    bool pattern_loaded ;     //F002 ran, play the pattern instead of the square wave
+    uint32_t rng ;            //xorshift32 state for CXNN, set with xorshift_seed()
+} chip8_t ;
+
+//CXNN generator, shared by the core, the batch lanes and the forks
+//xorshift32 instead of libc rand() so a seed gives the same numbers with every libc
+static inline uint32_t xorshift32(uint32_t *state) {
+    uint32_t x = *state ;
+    x ^= x << 13 ;
+    x ^= x >> 17 ;
+    x ^= x << 5 ;
+    return *state = x ;
+}
+
+//generator state for a seed, never 0 (xorshift would get stuck)
+static inline uint32_t xorshift_seed(uint32_t seed) {
+    return seed * 2654435761u | 1 ;
+}
+
+//Initialize chip8 object: load font and ROM, reset registers
+bool init_chip8 ( chip8_t *chip8, const char rom_name[]) ;
+
+//emulate 1 CHIP8 instruction
+void emulate_instruction(chip8_t *chip8 , const config_t config) ;
+
+//emulate up to count instructions with the profile's specialized loop
+//returns how many ran, fewer than count when a display wait ends the frame early
+uint32_t run_instructions(chip8_t *chip8 , const config_t config , uint32_t count) ;
+
+//profile by name (modern, vip, schip, xochip), false if unknown
+bool quirks_from_name(const char *name , quirk_profile_t *profile) ;
+const char *quirks_name(quirk_profile_t profile) ;
+
+//profile guessed from the ROM file extension (.sc8 SUPER-CHIP, .xo8 XO-CHIP, else modern)
+quirk_profile_t quirks_for_rom(const char *rom_name) ;
+
+//60Hz tick of delay and sound timers
+void tick_timers(chip8_t *chip8) ;
+
+//hash of the whole machine state (RAM, display, V, I, PC, stack, timers), cheap to call every frame
+//equal machines hash equal across runs and builds, the keypad is input and not part of it
+uint64_t chip8_hash(const chip8_t *chip8) ;
+
+//running hash over a sequence of frames: prev is the chain value after the previous frame
+//unlike chip8_hash() alone it never re-converges, once two runs differ every later value
+//differs too, so a binary search over it finds the first diverging frame
+uint64_t chip8_hash_chain(uint64_t prev , const chip8_t *chip8) ;
+
+//recompute ram_hash and disp_hash after ram or display were changed directly
+void chip8_rehash(chip8_t *chip8) ;
+
+#ifdef DEBUG
+void print_debug_info( chip8_t *chip8, config_t config) ;
+#endif
+
+#endif //CHIP8_H
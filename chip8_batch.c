@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8_batch.h"
+#include "simd.h"
+
+//xorshift32, one independent stream per lane so results do not depend on lane order
+static inline uint32_t lane_rand(chip8_batch_t *b, uint32_t l) {
+    return xorshift32(&b -> rng[l]) ;
+}
+
+#define CODE_CHUNK 64      //bytes of RAM per bit of the same/unverified bitmaps
+
+//RAM write by the scalar fallback, the written range is compared across lanes before lockstep trusts it
+static inline void lane_ram_write(chip8_batch_t *b, uint32_t l, uint16_t addr, uint8_t value) {
+    addr &= 0xFFF ;
+    b -> ram[l][addr] = value ;
+    if ( addr < b -> written_lo) b -> written_lo = addr ;
+    if ( addr > b -> written_hi) b -> written_hi = addr ;
+}
+
+//scalar fallback: emulate_instruction() on lane l, one instantiation per quirk profile
+#define EXEC_PARAMS      chip8_batch_t *b, const uint32_t l
+#define EX_INST          b -> inst
+#define EX_V(r)          b -> V[(r)*b -> stride + l]
+#define EX_I             b -> I[l]
+#define EX_PC            b -> PC[l]
+#define EX_DT            b -> delay_timer[l]
+#define EX_ST            b -> sound_timer[l]
+#define EX_RAM(a)        b -> ram[l][(a) & 0xFFF]
+#define EX_RAM_WR(a, v)  lane_ram_write(b, l, a, v)
+#define EX_DISP(i)       b -> display[l][i]
+#define EX_DISP_FLIP(i)  (b -> display[l][i] ^= 1)
+#define EX_DISP_CLEAR()  memset(b -> display[l], false, sizeof b -> display[l])
+#define EX_PUSH(a)       (b -> stack[(b -> sp[l]++ % STACK_DEPTH)*b -> stride + l] = (a))
+#define EX_POP()         (b -> stack[(--b -> sp[l] % STACK_DEPTH)*b -> stride + l])
+#define EX_KEY(k)        b -> keypad[l][(k) & 0xF]
+#define EX_RAND()        lane_rand(b, l)
+#define EX_W             b -> config.window_width
+#define EX_H             b -> config.window_height
+#define EX_TRACE()       (void)0
+#define EX_WATCH(a, n, kind) (void)0
+#define EX_AUDIO_PATTERN(a) (void)0   //lanes have no audio output
+#define EX_AUDIO_PITCH(v)   (void)0
+
+#define EXEC_NAME exec_lane_modern
+#define EX_QUIRKS QUIRKS_MODERN
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_lane_vip
+#define EX_QUIRKS QUIRKS_VIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_lane_schip
+#define EX_QUIRKS QUIRKS_SCHIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_lane_xochip
+#define EX_QUIRKS QUIRKS_XOCHIP
+#include "chip8_exec.inc"
+
+chip8_batch_t *chip8_batch_create(const chip8_t *proto, const config_t config, uint32_t n, uint32_t seed, bool (*display)[64*32]) {
+    if ( n == 0) return NULL ;
+
+    chip8_batch_t *b = calloc(1, sizeof *b) ;
+    if ( !b) return NULL ;
+
+    b -> n = n ;
+    b -> stride = (n + VBYTES - 1) / VBYTES * VBYTES ;
+    b -> config = config ;
+
+    const size_t s = b -> stride ;
+    b -> V = calloc(16*s, sizeof *b -> V) ;
+    b -> I = calloc(s, sizeof *b -> I) ;
+    b -> PC = calloc(s, sizeof *b -> PC) ;
+    b -> delay_timer = calloc(s, 1) ;
+    b -> sound_timer = calloc(s, 1) ;
+    b -> sp = calloc(s, 1) ;
+    b -> stack = calloc(STACK_DEPTH*s, sizeof *b -> stack) ;
+    b -> rng = calloc(s, sizeof *b -> rng) ;
+    b -> mask = calloc(s, 1) ;
+    b -> cond = calloc(s, 1) ;
+    b -> waiting = calloc(s, 1) ;
+    b -> same = calloc(s, sizeof *b -> same) ;
+    b -> ram = calloc(n, sizeof *b -> ram) ;
+    b -> owns_display = display == NULL ;
+    b -> display = display ? display : calloc(n, sizeof *b -> display) ;
+    b -> keypad = calloc(n, sizeof *b -> keypad) ;
+
+    if ( !b -> V || !b -> I || !b -> PC || !b -> delay_timer || !b -> sound_timer || !b -> sp ||
+         !b -> stack || !b -> rng || !b -> mask || !b -> cond || !b -> waiting || !b -> same || !b -> ram || !b -> display || !b -> keypad) {
+        chip8_batch_destroy(b) ;
+        return NULL ;
+    }
+
+    for ( uint32_t l = 0 ; l < n ; l ++) {
+        chip8_batch_load_lane(b, l, proto) ;
+        b -> rng[l] = xorshift_seed(seed + l) ;
+    }
+    memset(b -> waiting + n, 1, s - n) ; //padding lanes never follow
+    b -> written_lo = 0xFFFF ;
+    return b ;
+}
+
+void chip8_batch_destroy(chip8_batch_t *b) {
+    if ( !b) return ;
+    free(b -> V) ;
+    free(b -> I) ;
+    free(b -> PC) ;
+    free(b -> delay_timer) ;
+    free(b -> sound_timer) ;
+    free(b -> sp) ;
+    free(b -> stack) ;
+    free(b -> rng) ;
+    free(b -> mask) ;
+    free(b -> cond) ;
+    free(b -> waiting) ;
+    free(b -> same) ;
+    free(b -> ram) ;
+    if ( b -> owns_display) free(b -> display) ;
+    free(b -> keypad) ;
+    free(b) ;
+}
+
+void chip8_batch_load_lane(chip8_batch_t *b, uint32_t l, const chip8_t *chip8) {
+    const uint32_t s = b -> stride ;
+    for ( uint32_t r = 0 ; r < 16 ; r ++) b -> V[r*s + l] = chip8 -> V[r] ;
+    b -> I[l] = chip8 -> I ;
+    b -> PC[l] = chip8 -> PC ;
+    b -> delay_timer[l] = chip8 -> delay_timer ;
+    b -> sound_timer[l] = chip8 -> sound_timer ;
+    b -> sp[l] = chip8 -> stack_top ? (uint8_t)(chip8 -> stack_top - chip8 -> stack) : 0 ;
+    for ( uint32_t d = 0 ; d < STACK_DEPTH ; d ++) b -> stack[d*s + l] = chip8 -> stack[d] ;
+    memcpy(b -> ram[l], chip8 -> ram, sizeof b -> ram[l]) ;
+    memcpy(b -> display[l], chip8 -> display, sizeof b -> display[l]) ;
+    memcpy(b -> keypad[l], chip8 -> keypad, sizeof b -> keypad[l]) ;
+    b -> waiting[l] = 0 ;
+    b -> mask_valid = false ;
+    b -> unverified = UINT64_MAX ; //new RAM, every chunk is compared again
+}
+
+void chip8_batch_store_lane(const chip8_batch_t *b, uint32_t l, chip8_t *chip8) {
+    const uint32_t s = b -> stride ;
+    for ( uint32_t r = 0 ; r < 16 ; r ++) chip8 -> V[r] = b -> V[r*s + l] ;
+    chip8 -> I = b -> I[l] ;
+    chip8 -> PC = b -> PC[l] ;
+    chip8 -> delay_timer = b -> delay_timer[l] ;
+    chip8 -> sound_timer = b -> sound_timer[l] ;
+    for ( uint32_t d = 0 ; d < STACK_DEPTH ; d ++) chip8 -> stack[d] = b -> stack[d*s + l] ;
+    chip8 -> stack_top = chip8 -> stack + b -> sp[l] % STACK_DEPTH ;
+    memcpy(chip8 -> ram, b -> ram[l], sizeof chip8 -> ram) ;
+    memcpy(chip8 -> display, b -> display[l], sizeof chip8 -> display) ;
+    chip8_rehash(chip8) ;
+    memcpy(chip8 -> keypad, b -> keypad[l], sizeof chip8 -> keypad) ;
+}
+
+//PC += 2 on masked lanes, plus another 2 where the cond row is set
+static void pc_advance(chip8_batch_t *b, bool use_cond) {
+    const v16_t two = (v16_t){0} + 2 ;
+    for ( uint32_t k = 0 ; k < b -> stride ; k += VBYTES/2) {
+        v16_t add = two ;
+        if ( use_cond) add += two & widen_mask(b -> cond + k) ;
+        const v16_t pc = ld16(b -> PC + k) ;
+        st16(b -> PC + k, blend16(widen_mask(b -> mask + k), pc + add, pc)) ;
+    }
+}
+
+//PC = value (+ 8 bit row) on masked lanes
+static void pc_set(chip8_batch_t *b, uint16_t value, const uint8_t *offset_row) {
+    for ( uint32_t k = 0 ; k < b -> stride ; k += VBYTES/2) {
+        v16_t target = (v16_t){0} + value ;
+        if ( offset_row) target += widen8(offset_row + k) ;
+        st16(b -> PC + k, blend16(widen_mask(b -> mask + k), target, ld16(b -> PC + k))) ;
+    }
+}
+
+//cond row = (a == b) or (a != b), b is a row or a broadcast constant
+static void cond_compare(chip8_batch_t *b, const uint8_t *a_row, const uint8_t *b_row, uint8_t imm, bool equal) {
+    for ( uint32_t k = 0 ; k < b -> stride ; k += VBYTES) {
+        const v8_t rhs = b_row ? ld8(b_row + k) : (v8_t){0} + imm ;
+        v8_t eq = (v8_t)(ld8(a_row + k) == rhs) ;
+        st8(b -> cond + k, equal ? eq : ~eq) ;
+    }
+}
+
+//vector kernels, one instantiation per quirk profile
+#define LOCKSTEP_NAME lockstep_modern
+#define EX_QUIRKS QUIRKS_MODERN
+#include "chip8_lockstep.inc"
+
+#define LOCKSTEP_NAME lockstep_vip
+#define EX_QUIRKS QUIRKS_VIP
+#include "chip8_lockstep.inc"
+
+#define LOCKSTEP_NAME lockstep_schip
+#define EX_QUIRKS QUIRKS_SCHIP
+#include "chip8_lockstep.inc"
+
+#define LOCKSTEP_NAME lockstep_xochip
+#define EX_QUIRKS QUIRKS_XOCHIP
+#include "chip8_lockstep.inc"
+
+//number of nonzero entries of an 8 bit row
+static uint32_t count_set(const uint8_t *row, uint32_t stride) {
+    v16_t acc = (v16_t){0} ;
+    for ( uint32_t k = 0 ; k < stride ; k += VBYTES/2) acc += (v16_t)(widen8(row + k) != 0) & 1 ;
+    uint32_t sum = 0 ;
+    for ( uint32_t i = 0 ; i < VBYTES/2 ; i ++) sum += acc[i] ;
+    return sum ;
+}
+
+//compare the chunks every lane has against the leader's RAM, which becomes the new reference
+static void verify_code(chip8_batch_t *b, uint64_t chunks) {
+    const uint8_t *lead = b -> ram[b -> leader] ;
+    for ( uint32_t c = 0 ; c < 4096 / CODE_CHUNK ; c ++) {
+        const uint64_t bit = 1ull << c ;
+        if ( !(chunks & bit)) continue ;
+        uint8_t *ref = b -> code + c*CODE_CHUNK ;
+        memcpy(ref, lead + c*CODE_CHUNK, CODE_CHUNK) ;
+        for ( uint32_t l = 0 ; l < b -> n ; l ++) {
+            if ( memcmp(b -> ram[l] + c*CODE_CHUNK, ref, CODE_CHUNK) == 0) b -> same[l] |= bit ;
+            else b -> same[l] &= ~bit ;
+        }
+    }
+    b -> unverified &= ~chunks ;
+    b -> same_all = UINT64_MAX ;
+    for ( uint32_t l = 0 ; l < b -> n ; l ++) b -> same_all &= b -> same[l] ;
+}
+
+//recheck the bytes the scalar fallback wrote: lanes keep their same bits only if they wrote what the leader wrote
+//writes spread over more than a chunk are left to a full compare of the chunks once code runs from them
+static void verify_written(chip8_batch_t *b) {
+    const uint32_t lo = b -> written_lo, hi = b -> written_hi ;
+    b -> written_lo = 0xFFFF ;
+    b -> written_hi = 0 ;
+    if ( lo > hi) return ;
+    if ( hi - lo >= CODE_CHUNK) {
+        for ( uint32_t c = lo / CODE_CHUNK ; c <= hi / CODE_CHUNK ; c ++) b -> unverified |= 1ull << c ;
+        return ;
+    }
+
+    const uint32_t len = hi - lo + 1 ;
+    const uint64_t bits = 1ull << (lo / CODE_CHUNK) | 1ull << (hi / CODE_CHUNK) ;
+    memcpy(b -> code + lo, b -> ram[b -> leader] + lo, len) ;
+    b -> same_all = UINT64_MAX ;
+    for ( uint32_t l = 0 ; l < b -> n ; l ++) {
+        if ( (b -> same[l] & bits) && memcmp(b -> ram[l] + lo, b -> code + lo, len) != 0) b -> same[l] &= ~bits ;
+        b -> same_all &= b -> same[l] ;
+    }
+}
+
+//mask = lanes at the leader's PC with the leader's opcode there, need holds the code chunks of the opcode
+static void build_mask(chip8_batch_t *b, uint16_t pc, uint64_t need) {
+    const uint32_t lead = b -> leader ;
+    verify_written(b) ;
+    if ( (b -> unverified & need) || (b -> same[lead] & need) != need) verify_code(b, need) ;
+
+    const v16_t lead_pc = (v16_t){0} + b -> PC[lead] ;
+    for ( uint32_t k = 0 ; k < b -> stride ; k += VBYTES/2) {
+        const v16_t at_pc = (v16_t)(ld16(b -> PC + k) == lead_pc) ;
+        const v16_t running = (v16_t)(widen8(b -> waiting + k) == 0) ;
+        narrow16(b -> mask + k, at_pc & running) ;
+    }
+
+    //only lanes whose code chunk differs from the leader's compare the opcode bytes themselves
+    if ( (b -> same_all & need) != need) {
+        const uint8_t hi = b -> code[pc], lo = b -> code[(pc + 1) & 0xFFF] ;
+        for ( uint32_t l = 0 ; l < b -> n ; l ++) {
+            if ( !b -> mask[l] || (b -> same[l] & need) == need) continue ;
+            if ( b -> ram[l][pc] != hi || b -> ram[l][(pc + 1) & 0xFFF] != lo) b -> mask[l] = 0 ;
+        }
+    }
+    b -> followers = count_set(b -> mask, b -> stride) ;
+    b -> active = b -> stride - count_set(b -> waiting, b -> stride) ;
+}
+
+//opcodes that leave every follower at the same PC, so the mask carries over to the next step
+static inline bool pc_uniform(uint16_t opcode) {
+    switch ( opcode >> 12) {
+        case 0x0: return (opcode & 0xFF) != 0xEE ; //return addresses come from per lane stacks
+        case 0x3: case 0x4: case 0x5: case 0x9: case 0xB: return false ;
+        default: return true ;
+    }
+}
+
+//one instruction on every lane, lockstep and exec are the kernels of one quirk profile
+//always inlined so the specialized loops below call them directly
+static inline __attribute__((always_inline)) void batch_step_once(chip8_batch_t *b,
+        bool (*lockstep)(chip8_batch_t *, uint16_t), bool (*exec)(chip8_batch_t *, uint32_t)) {
+    //a leader parked on a display wait can't lead
+    if ( b -> waiting[b -> leader]) {
+        uint32_t l = 0 ;
+        while ( l < b -> n && b -> waiting[l]) l ++ ;
+        if ( l == b -> n) return ; //every lane waits for the next frame
+        b -> leader = l ;
+        b -> mask_valid = false ;
+    }
+
+    const uint32_t lead = b -> leader ;
+    const uint16_t pc = b -> PC[lead] & 0xFFF ;
+    const uint16_t opcode = b -> ram[lead][pc] << 8 | b -> ram[lead][(pc + 1) & 0xFFF] ;
+    const uint64_t need = 1ull << (pc / CODE_CHUNK) | 1ull << (((pc + 1) & 0xFFF) / CODE_CHUNK) ;
+
+    //every active lane followed last step and still shares one PC, the mask holds while their code there is the same
+    if ( !b -> mask_valid || (b -> unverified & need) || (b -> same_all & need) != need) build_mask(b, pc, need) ;
+    b -> mask_valid = false ;
+    const uint32_t followers = b -> followers, active = b -> active ;
+
+    if ( !lockstep(b, opcode)) {
+        for ( uint32_t l = 0 ; l < b -> n ; l ++)
+            if ( !b -> waiting[l] && !exec(b, l)) b -> waiting[l] = 1 ;
+        b -> scalar_steps += active ;
+        return ;
+    }
+    b -> lockstep_steps += followers ;
+    if ( followers == active) {
+        b -> mask_valid = pc_uniform(opcode) ;
+        return ;
+    }
+
+    //diverged lanes, and pick one of them as next leader if the leader lost the majority
+    uint32_t first_other = lead ;
+    for ( uint32_t l = 0 ; l < b -> n ; l ++) {
+        if ( b -> mask[l] || b -> waiting[l]) continue ;
+        if ( first_other == lead) first_other = l ;
+        if ( !exec(b, l)) b -> waiting[l] = 1 ; //display wait parks the lane until the next timer tick
+    }
+    b -> scalar_steps += active - followers ;
+    if ( followers * 2 < active) b -> leader = first_other ;
+}
+
+//specialized step loops, the profile is picked once per chip8_batch_step() instead of per instruction
+#define STEP_LOOP(name, lockstep, exec)                             \
+    static void name(chip8_batch_t *b, uint32_t count) {            \
+        for ( uint32_t i = 0 ; i < count ; i ++)                    \
+            batch_step_once(b, lockstep, exec) ;                    \
+    }
+STEP_LOOP(step_modern, lockstep_modern, exec_lane_modern)
+STEP_LOOP(step_vip, lockstep_vip, exec_lane_vip)
+STEP_LOOP(step_schip, lockstep_schip, exec_lane_schip)
+STEP_LOOP(step_xochip, lockstep_xochip, exec_lane_xochip)
+
+static void (*const step_table[PROFILE_COUNT])(chip8_batch_t *, uint32_t) = {
+    [PROFILE_MODERN] = step_modern,
+    [PROFILE_VIP]    = step_vip,
+    [PROFILE_SCHIP]  = step_schip,
+    [PROFILE_XOCHIP] = step_xochip,
+} ;
+
+void chip8_batch_step(chip8_batch_t *b, uint32_t count) {
+    step_table[b -> config.quirks](b, count) ;
+}
+
+void chip8_batch_update_timers(chip8_batch_t *b) {
+    //new frame, lanes parked on a display wait go again
+    memset(b -> waiting, 0, b -> n) ;
+    b -> mask_valid = false ;
+
+    //saturating decrement, (t != 0) is all ones (-1) exactly where t > 0
+    for ( uint32_t k = 0 ; k < b -> stride ; k += VBYTES) {
+        const v8_t dt = ld8(b -> delay_timer + k), st = ld8(b -> sound_timer + k) ;
+        st8(b -> delay_timer + k, dt + (v8_t)(dt != 0)) ;
+        st8(b -> sound_timer + k, st + (v8_t)(st != 0)) ;
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef CHIP8_BATCH_H
+#define CHIP8_BATCH_H
+
+#include "chip8.h"
+
+//lockstep batch interpreter: N copies of the same ROM in structure-of-arrays form
+//registers, I, PC and timers are stored as rows with one entry per lane
+//(V[r*stride + lane]) so one opcode can be applied to every lane with SSE2/AVX2,
+//RAM, display and keypad stay per lane
+//lanes whose PC or opcode differs from the leader that step run the scalar
+//emulate_instruction() semantics instead
+//
+//the follower mask is kept across steps while every lane stays in lockstep, and is
+//rebuilt from vector compares of the PC row otherwise; the opcode bytes of a lane are
+//only compared one by one after that lane wrote to the 64 byte code chunk they sit in
+
+typedef struct {
+    uint32_t n ;              //number of machines (lanes)
+    uint32_t stride ;         //n rounded up to the vector width, length of every row
+    uint32_t leader ;         //lane whose opcode is run vectorized this step
+    config_t config ;
+    instruction_t inst ;      //decode scratch for the scalar fallback
+
+    uint8_t  *V ;             //V[r*stride + lane]
+    uint16_t *I ;             //index register per lane
+    uint16_t *PC ;            //program counter per lane
+    uint8_t  *delay_timer ;
+    uint8_t  *sound_timer ;
+    uint8_t  *sp ;            //stack depth per lane
+    uint16_t *stack ;         //stack[depth*stride + lane]
+    uint32_t *rng ;           //per lane xorshift state for CXNN
+    uint8_t  *mask ;          //0xFF for lanes following the leader this step
+    uint8_t  *cond ;          //scratch row for skip conditions
+    uint8_t  *waiting ;       //lanes parked on a display wait until the next timer tick, padding lanes always
+    bool     mask_valid ;     //mask still holds every active lane, all at one PC
+    uint32_t followers ;      //lanes set in mask
+    uint32_t active ;         //lanes not waiting
+
+    uint64_t *same ;          //per lane bit c: ram[c*64 .. c*64+63] equals code[] there
+    uint64_t same_all ;       //chunks every lane has in same
+    uint64_t unverified ;     //chunks to compare in full before same is trusted again
+    uint16_t written_lo ;     //RAM range the scalar fallback wrote since the last check, empty when lo > hi
+    uint16_t written_hi ;
+    uint8_t  code[4096] ;     //reference RAM same compares against, taken from the leader
+
+    uint8_t  (*ram)[4096] ;   //per lane RAM
+    bool     (*display)[64*32] ; //per lane display
+    bool     owns_display ;   //display was allocated here, not passed in by the caller
+    bool     (*keypad)[16] ;  //per lane keypad
+
+    uint64_t lockstep_steps ; //lane-steps executed vectorized
+    uint64_t scalar_steps ;   //lane-steps executed by the scalar fallback
+} chip8_batch_t ;
+
+//create n lanes, each a copy of proto (already set up by init_chip8)
+//seed feeds the per lane random generators so runs are reproducible
+//display may point at caller memory for n displays (lanes then draw straight into it), or be NULL
+chip8_batch_t *chip8_batch_create(const chip8_t *proto, const config_t config, uint32_t n, uint32_t seed, bool (*display)[64*32]) ;
+void chip8_batch_destroy(chip8_batch_t *batch) ;
+
+//copy a machine into / out of one lane
+void chip8_batch_load_lane(chip8_batch_t *batch, uint32_t lane, const chip8_t *chip8) ;
+void chip8_batch_store_lane(const chip8_batch_t *batch, uint32_t lane, chip8_t *chip8) ;
+
+//run count instructions on every lane (lanes on a display wait sit the rest out)
+void chip8_batch_step(chip8_batch_t *batch, uint32_t count) ;
+
+//60Hz tick of delay and sound timers on every lane, also ends display waits
+void chip8_batch_update_timers(chip8_batch_t *batch) ;
+
+#endif //CHIP8_BATCH_H
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_hash.h"
+#include "debugger.h"
+
+//core of the emulator: ROM loading and instruction execution
+//no SDL in here, the frontend (chip8.c) and the batch engine both build on it
+
+//Initialize chip8 object
+bool init_chip8 ( chip8_t *chip8, const char rom_name[]) {
+    const uint32_t entry_point = 0x200;  //CHIP8 ROMs are loaded to 0x200
+    const uint8_t  font[] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+    } ;
+
+    //load font
+    memcpy(&chip8->ram[0] , font , sizeof(font)) ;
+
+    //open rom file
+    FILE *rom = fopen(rom_name, "rb") ;  //ROM is the .ch8 file with code/instructions and all 
+    if (!rom) {
+        fprintf(stderr, "Rom file %s can't be opened, is invalid or non-existent!!!\n", rom_name) ;
+        return false;
+    }
+    fseek(rom , 0 , SEEK_END) ;
+    const size_t rom_size = ftell(rom) ;
+    const size_t max_size = sizeof(chip8->ram) - entry_point;
+
+    if ( rom_size > max_size) {
+        fprintf(stderr, "Rom file %s is tooo bigg!!! ROM size: %u , max availible CHIP8 memory: %u\n", rom_name, (unsigned)rom_size, (unsigned)max_size) ;
+        return false;
+    }
+
+
+    rewind(rom) ; // seek to beginning of file
+    if( fread( &chip8->ram[entry_point] , rom_size , 1 , rom) != 1) { //load ROM data into RAM here
+        fprintf(stderr, "Could not read rom file %s into CHIP8 memory\n", rom_name) ;
+        return false;
+    }
+    fclose(rom) ; // close file after loading
+
+    //Set CHIP8 machine defaults
+    chip8 -> state = RUNNING ; //default machine state
+    chip8 -> PC = entry_point ; // Start program where ROM instructions start
+    chip8 -> stack_top = chip8 -> stack ;
+    chip8 -> rom_name = rom_name ;
+    chip8 -> pitch = 64 ; //XO-CHIP default, 4000Hz
+    chip8 -> rng = xorshift_seed(1) ; //the frontend reseeds from --seed or the clock
+    chip8_rehash(chip8) ;
+    return true ;
+}
+
+#ifdef DEBUG
+void print_debug_info( chip8_t *chip8, config_t config) {
+    // Emulate opcode
+    printf( "Address : 0x%04X, opcode: 0x%04X , Desc: ", chip8 -> PC -2 , chip8 -> inst.opcode) ;
+    switch ((chip8 ->inst.opcode >>12) & 0x0F) { //this is switch for D or the type/category of instruction that the machine has to currently execute
+        
+        case 0x0:
+            switch (chip8 -> inst.NN) {
+                case 0xE0 :
+                    //0x00E0: clear screen
+                    printf("Clear Screen\n") ;
+                    break;
+                case 0XEE :
+                    //0x00EE: return from subroutine (pop instruction from stack)
+                    printf("Return from subroutine to address 0x%04X\n",*(chip8 ->stack_top - 1) ) ;
+                    break ;
+                default:
+                    printf("Unimplemented opcode!!!\n") ;
+                    break;
+            }
+            break ;
+
+        case 0x01:
+            // 0x1NNN : jump(PC) to address NNN
+            printf( "jump to address NNN (0x%03X)\n", chip8 -> inst.NNN) ;
+            break ;
+
+        case 0x02:
+            //0x2NNN: call subroutine at NNN (push instruction to stack)
+            printf("Store address 0x%04X and jump to NNN (0x%03X)\n", *chip8 ->stack_top, chip8 -> inst.NNN) ;
+            break  ;
+
+        case 0x03:
+            //0x3XNN: skip next instruction if VX==NN
+            printf ( "If V%X == NN (0x%02X == 0x%02X), skip next instruction\n",chip8 -> inst.X , chip8 -> V[chip8 -> inst.X],chip8 -> inst.NN);
+            break ;
+
+        case 0x04:
+            //0x4XNN: skip next instruction if VX!=NN
+            printf ( "If V%X != NN (0x%02X != 0x%02X), skip next instruction\n",chip8 -> inst.X , chip8 -> V[chip8 -> inst.X],chip8 -> inst.NN);
+            break ;
+
+        case 0x05:
+            //0x5XY0: skip next instruction if VX==VY
+            if (chip8 -> inst.N != 0){
+                printf("Invalid opcode!!!\n"); //invalid opcode
+                break;
+            }
+            printf ( "If V%X == V%X  (0x%02X == 0x%02X), skip next instruction\n",chip8 -> inst.X ,chip8 -> inst.Y, chip8 -> V[chip8 -> inst.X],chip8 -> V[chip8 -> inst.Y]);
+            break ;
+
+        case 0x06:
+            //0x6NNN: Set register VX to NN
+            //basically put NN in register V[X]
+            printf( "Set V%X to NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN) ;
+            break;
+
+        case 0x07:
+            //0x7NNN: Add NN to VX
+            //basically V[X] += NN
+            printf( "Add: V%X += NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN) ;
+            break;
+
+        case 0x08: 
+            //0x8XYN:VX VY related ALU instructions
+            switch ( chip8 -> inst.N) {
+                case 0x0 :
+                    //Set VX = VY
+                    printf( "Set V%X (0x%02X) to V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break;
+                case 0x01 :
+                    //Set VX |= VY
+                    printf( "Set V%X (0x%02X) | = V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break ;
+                case 0x02 :
+                    //Set VX &= VY
+                    printf( "Set V%X (0x%02X) &= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break ;
+                case 0x03 :
+                    //Set VX ^= VY
+                    printf( "Set V%X (0x%02X) ^= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break ;
+                case 0x04 :
+                    //Set VX += VY, VF is for overflow, VF = 1 if carry
+                    printf( "Set V%X (0x%02X) += V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break ;
+                case 0x05 :
+                    //Set VX -= VY, VF is for underflow, VF = 0 if borrow
+                    printf( "Set V%X (0x%02X) -= V%X (0x%02X)\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break;
+                case 0x06 :
+                    //Set VX >>= 1, VF is leftmost bit before shift
+                    printf( "Set V%X (0x%02X) >>= 1\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
+                    break;
+                case 0x07 :
+                    //Set VX = VY - VX, VF is for underflow, VF = 0 if borrow
+                    printf( "Set V%X (0x%02X) -= V%X (0x%02X), VX = - VX\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] , chip8 -> inst.Y , chip8 -> V[chip8 -> inst.Y] ) ;
+                    break;
+                case 0x0E :
+                    //Set VX >>= 1, VF is leftmost bit before shift
+                    printf( "Set V%X (0x%02X) <<= 1\n" , chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
+                    break;
+                default :
+                    printf("Invalid opcode!!!\n") ;
+                    break ; //invalid
+            }
+            break ;
+
+        case 0x09:
+            //0x9XY0: skip next instruction if VX!=VY
+            if (chip8 -> inst.N != 0){
+                printf("Invalid opcode!!!\n"); //invalid opcode
+                break;
+            }
+            printf ( "If V%X == V%X  (0x%02X != 0x%02X), skip next instruction\n",chip8 -> inst.X ,chip8 -> inst.Y, chip8 -> V[chip8 -> inst.X],chip8 -> V[chip8 -> inst.Y]);
+            break ;
+
+        case 0x0A:
+            // 0xANNN: Set index register to NNN
+            printf( "Set I to NNN (0x%03X)\n" , chip8 -> inst.NNN) ;
+            break;
+
+        case 0x0B:
+            // 0xBNNN: jump to V0 + NNN
+            printf( "jump to address V0 (0x%02X) + NNN (0x%03X)\n", chip8 -> V[0], chip8 -> inst.NNN) ;
+            break;
+
+        case 0x0C:
+            // 0xCXNN: Sets VX = rand(0,255) & NN 
+            printf( "Set V%X = rand %% 256 & NN (0x%02X)\n" , chip8 -> inst.X , chip8 -> inst.NN ) ;
+            break ;
+
+        case 0x0D:
+            //0xDXYN: Draw sprite at coords VX,VY of height N
+            //sprite XORs the screen where drawn
+            //VF(carry flag) is set if any pixels are turned off, useful for collisions???
+            uint8_t X_coord = chip8 -> V[chip8 -> inst.X] % config.window_width;
+            uint8_t Y_coord = chip8 -> V[chip8 -> inst.Y] % config.window_height;
+            //const uint8_t original_X = X_coord ;
+            chip8 -> V[0xF] = 0 ; //initialize carry flag to 0???
+
+            printf ( "Display sprite at V%X,V%X (%u,%u) of height N (%u).\n" ,chip8 -> inst.X , chip8 -> inst.Y, X_coord, Y_coord,chip8 -> inst.N) ;
+
+            break;
+
+        case 0x0E:
+            //0xEXNN: key pressed if statements
+            switch (chip8 -> inst.NN) {
+                case 0x09E:
+                    //0xEX9E: if key stored in VX is pressed, skip instruction
+                    printf ( "If key stored in V%X (0x%02X) is pressed, skip next instruction\n", chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
+                    break ;
+                case 0x0A1:
+                    //0xEXA1: if key stored in VX is not pressed, skip instruction
+                    printf ( "If key stored in V%X (0x%02X) is not pressed, skip next instruction\n", chip8 -> inst.X , chip8 -> V[chip8 -> inst.X] ) ;
+                    break ;
+                default:
+                    printf("Invalid opcode!!!\n") ;
+                    break ; //invalid
+            }
+            break ;
+
+        case 0x0F:
+            //0xFXNN: misc with register VX
+            switch ( chip8 -> inst.NN) {
+                case 0x07 :
+                    //0xVX07: sets VX to delay timer
+                    printf("Sets V%X = delay timer (0x%02X)\n", chip8 -> inst.X , chip8 -> delay_timer ) ;
+                    break ;
+                case 0x0A :
+                    //0xVX07: await for a keypress, then store first keypress in VX
+                    printf( "Wait till key pree, store at V%X\n", chip8 -> inst.X ) ;
+                    break ;
+                case 0x15 :
+                    //0xFX15: Set delay timer to VX
+                    printf( "Set delay timer to V%X (0x%02X)\n",chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
+                    break ;    
+                case 0x18 :
+                    //0xFX15: Set sound timer to VX
+                    printf( "Set sound timer to V%X (0x%02X)\n",chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
+                    break ;
+                case 0x1E :
+                    //0xFX15: Set I += VX
+                    printf("Set I (0x%04X) += V%X (0x%02X)\n",chip8 -> I,chip8 -> inst.X,chip8 -> V[chip8 -> inst.X] ) ;
+                    break ;  
+                case 0x29 :
+                    //0xFX29: Set I to location of sprite/font of char stored in VX(0x0-0xF) from RAM
+                    if ((chip8 -> V[chip8 -> inst.X]) > 0xF) {
+                        printf("VX stores value > F\n") ;
+                        break ; //font not availible
+                    }
+                    printf( "Set I to the sprite location in V%X (0x%02X)\n", chip8 -> inst.X,chip8 -> V[chip8 -> inst.X]) ;
+                    break;
+                case 0x33 :
+                    //0xFX33: Store BCD(VX(0-255)) at location I,I+1,I+2; eg. if VX=205 and I=5 then ram[5]=2,ram[6]=0 ,ram[7]=5
+                    printf("Store BCD at V%X (0x%02X) in RAM starting from location I (0x%04X)\n", chip8 -> inst.X,chip8 -> V[chip8 -> inst.X], chip8 -> I) ;
+                    break;    
+                case 0x55 :
+                    //0xFX55: Dump V0 to VX in ram starting from indesx stored at I, basically ram[I]=V0, ram[I+1]=V1 ...ram[I+X] = V[x]
+                    printf( "Dump V0 to V%X into RAM starting from location I (0x%04X)\n", chip8 -> inst.X,  chip8 -> I) ;
+                    break;
+                case 0x65 :
+                    //0xFX65: Load registers V0 to VX with ram[I] to ram[I+X], opposite of above
+                    printf( "Load V0 to V%X from RAM starting from location I (0x%04X)\n", chip8 -> inst.X,  chip8 -> I) ;
+                    break;
+                default :
+                    break ; //invalid
+            }
+            break ;
+
+        default :
+            printf("Unimplemented opcode!!!\n") ;
+            break; //for invalid/unimplemented instructions
+    }
+}
+
+
+#endif
+
+//quirk values per profile, same lists the specialized loops below are compiled from
+const quirks_t quirk_table[PROFILE_COUNT] = {
+    [PROFILE_MODERN] = { QUIRKS_MODERN },
+    [PROFILE_VIP]    = { QUIRKS_VIP },
+    [PROFILE_SCHIP]  = { QUIRKS_SCHIP },
+    [PROFILE_XOCHIP] = { QUIRKS_XOCHIP },
+} ;
+
+static const char *const profile_names[PROFILE_COUNT] = {
+    [PROFILE_MODERN] = "modern",
+    [PROFILE_VIP]    = "vip",
+    [PROFILE_SCHIP]  = "schip",
+    [PROFILE_XOCHIP] = "xochip",
+} ;
+
+//RAM write keeping ram_hash up to date, addresses wrap at 4K like the batch and fork machines
+static inline void ram_write(chip8_t *chip8 , uint16_t addr , uint8_t value) {
+    addr &= 0xFFF ;
+    chip8 -> ram_hash ^= hash_ram_cell(addr, chip8 -> ram[addr]) ^ hash_ram_cell(addr, value) ;
+    chip8 -> ram[addr] = value ;
+}
+
+static inline void load_audio_pattern(chip8_t *chip8 , uint16_t addr) {
+    for ( uint32_t i = 0 ; i < 16 ; i ++) chip8 -> audio_pattern[i] = chip8 -> ram[(addr + i) & 0xFFF] ;
+    chip8 -> pattern_loaded = true ;
+}
+
+//emulate_instruction() on a plain chip8_t, one instantiation per quirk profile
+#define EXEC_PARAMS      chip8_t *chip8, const config_t *config
+#define EX_INST          chip8 -> inst
+#define EX_V(r)          chip8 -> V[r]
+#define EX_I             chip8 -> I
+#define EX_PC            chip8 -> PC
+#define EX_DT            chip8 -> delay_timer
+#define EX_ST            chip8 -> sound_timer
+#define EX_RAM(a)        chip8 -> ram[(a) & 0xFFF]
+#define EX_RAM_WR(a, v)  ram_write(chip8, a, v)
+#define EX_DISP(i)       chip8 -> display[i]
+#define EX_DISP_FLIP(i)  (chip8 -> disp_hash ^= hash_pixel(i), chip8 -> display[i] ^= 1)
+#define EX_DISP_CLEAR()  (memset(&chip8 -> display[0] , false, sizeof ( chip8 -> display ) ), chip8 -> disp_hash = 0)
+#define EX_PUSH(a)       (*chip8 -> stack_top ++ = (a))
+#define EX_POP()         (*--chip8 -> stack_top)
+#define EX_KEY(k)        chip8 -> keypad[(k) & 0xF]
+#define EX_RAND()        xorshift32(&chip8 -> rng)
+#define EX_W             config -> window_width
+#define EX_H             config -> window_height
+#ifdef DEBUG
+#define EX_TRACE()       print_debug_info(chip8, *config)
+#else
+#define EX_TRACE()       (void)0
+#endif
+#define EX_WATCH(a, n, kind) (void)0
+#define EX_AUDIO_PATTERN(a) load_audio_pattern(chip8, a)
+#define EX_AUDIO_PITCH(v)   (chip8 -> pitch = (v))
+
+#define EXEC_NAME exec_modern
+#define EX_QUIRKS QUIRKS_MODERN
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_vip
+#define EX_QUIRKS QUIRKS_VIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_schip
+#define EX_QUIRKS QUIRKS_SCHIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_xochip
+#define EX_QUIRKS QUIRKS_XOCHIP
+#include "chip8_exec.inc"
+
+//specialized hot loops, the profile is picked once per call instead of per instruction
+#define RUN_LOOP(name, exec)                                                        \
+    static uint32_t name(chip8_t *chip8, const config_t *config, uint32_t count) {  \
+        for ( uint32_t i = 0 ; i < count ; i ++)                                    \
+            if ( !exec(chip8, config)) return i + 1 ;                               \
+        return count ;                                                              \
+    }
+RUN_LOOP(run_modern, exec_modern)
+RUN_LOOP(run_vip, exec_vip)
+RUN_LOOP(run_schip, exec_schip)
+RUN_LOOP(run_xochip, exec_xochip)
+
+static uint32_t (*const run_table[PROFILE_COUNT])(chip8_t *, const config_t *, uint32_t) = {
+    [PROFILE_MODERN] = run_modern,
+    [PROFILE_VIP]    = run_vip,
+    [PROFILE_SCHIP]  = run_schip,
+    [PROFILE_XOCHIP] = run_xochip,
+} ;
+
+//armed debugger: the same instantiations with watchpoints compiled in
+//kept apart so the loops above don't pay for them
+#undef EXEC_PARAMS
+#undef EX_WATCH
+#define EXEC_PARAMS      chip8_t *chip8, const config_t *config, debugger_t *dbg
+#define EX_WATCH(a, n, kind) \
+    do { if ( dbg -> watch_pages & debugger_page_span(a, n)) debugger_watch_hit(dbg, a, n, kind) ; } while (0)
+
+#define EXEC_NAME exec_debug_modern
+#define EX_QUIRKS QUIRKS_MODERN
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_debug_vip
+#define EX_QUIRKS QUIRKS_VIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_debug_schip
+#define EX_QUIRKS QUIRKS_SCHIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_debug_xochip
+#define EX_QUIRKS QUIRKS_XOCHIP
+#include "chip8_exec.inc"
+
+//breakpoints are checked before every instruction, a watchpoint stops after the instruction that hit it
+#define RUN_DEBUG_LOOP(name, exec)                                                                  \
+    static uint32_t name(chip8_t *chip8, const config_t *config, debugger_t *dbg, uint32_t count) { \
+        for ( uint32_t i = 0 ; i < count ; i ++) {                                                  \
+            if ( debugger_break_due(dbg, chip8)) return i ;                                         \
+            if ( !exec(chip8, config, dbg) || dbg -> reason != BREAK_NONE) return i + 1 ;           \
+        }                                                                                           \
+        return count ;                                                                              \
+    }
+RUN_DEBUG_LOOP(run_debug_modern, exec_debug_modern)
+RUN_DEBUG_LOOP(run_debug_vip, exec_debug_vip)
+RUN_DEBUG_LOOP(run_debug_schip, exec_debug_schip)
+RUN_DEBUG_LOOP(run_debug_xochip, exec_debug_xochip)
+
+static uint32_t (*const run_debug_table[PROFILE_COUNT])(chip8_t *, const config_t *, debugger_t *, uint32_t) = {
+    [PROFILE_MODERN] = run_debug_modern,
+    [PROFILE_VIP]    = run_debug_vip,
+    [PROFILE_SCHIP]  = run_debug_schip,
+    [PROFILE_XOCHIP] = run_debug_xochip,
+} ;
+
+//emulate 1 CHIP8 instruction
+void emulate_instruction(chip8_t *chip8 , const config_t config) {
+    run_table[config.quirks](chip8, &config, 1) ;
+}
+
+//emulate up to count instructions, stops early on a display wait
+uint32_t run_instructions(chip8_t *chip8 , const config_t config , uint32_t count) {
+    return run_table[config.quirks](chip8, &config, count) ;
+}
+
+//emulate up to count instructions under the debugger
+uint32_t run_instructions_debug(chip8_t *chip8 , const config_t config , debugger_t *dbg , uint32_t count) {
+    dbg -> reason = BREAK_NONE ;
+    return run_debug_table[config.quirks](chip8, &config, dbg, count) ;
+}
+
+bool quirks_from_name(const char *name , quirk_profile_t *profile) {
+    for ( uint32_t p = 0 ; p < PROFILE_COUNT ; p ++) {
+        if ( strcmp(name, profile_names[p]) == 0) {
+            *profile = p ;
+            return true ;
+        }
+    }
+    return false ;
+}
+
+const char *quirks_name(quirk_profile_t profile) {
+    return profile < PROFILE_COUNT ? profile_names[profile] : "unknown" ;
+}
+
+quirk_profile_t quirks_for_rom(const char *rom_name) {
+    const char *ext = strrchr(rom_name, '.') ;
+    if ( !ext) return PROFILE_MODERN ;
+    if ( strcmp(ext, ".sc8") == 0 || strcmp(ext, ".sc") == 0) return PROFILE_SCHIP ;
+    if ( strcmp(ext, ".xo8") == 0) return PROFILE_XOCHIP ;
+    return PROFILE_MODERN ;
+}
+
+//60Hz tick of delay and sound timers
+void tick_timers(chip8_t *chip8) {
+    if ( chip8 -> delay_timer > 0) chip8 -> delay_timer -- ;
+    if ( chip8 -> sound_timer > 0) chip8 -> sound_timer -- ;
+}
+
+uint64_t chip8_hash(const chip8_t *chip8) {
+    const uint32_t max_depth = sizeof chip8 -> stack / sizeof chip8 -> stack[0] ;
+    uint32_t depth = chip8 -> stack_top ? (uint32_t)(chip8 -> stack_top - chip8 -> stack) : 0 ;
+    if ( depth > max_depth) depth = max_depth ;
+    return hash_fold(chip8 -> ram_hash, chip8 -> disp_hash, chip8 -> V, chip8 -> I, chip8 -> PC,
+                     chip8 -> stack, depth, chip8 -> delay_timer, chip8 -> sound_timer) ;
+}
+
+uint64_t chip8_hash_chain(uint64_t prev , const chip8_t *chip8) {
+    return hash_mix64(prev ^ chip8_hash(chip8)) ;
+}
+
+void chip8_rehash(chip8_t *chip8) {
+    chip8 -> ram_hash = hash_ram(chip8 -> ram) ;
+    chip8 -> disp_hash = hash_display((const uint8_t *)chip8 -> display, sizeof chip8 -> display) ;
+}
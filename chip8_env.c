@@ -0,0 +1,185 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8_batch.h"
+#include "chip8_env.h"
+
+//one worker's share of the envs, a batch over envs [first, first + batch->n)
+typedef struct {
+    chip8_env_t *env ;
+    chip8_batch_t *batch ;
+    uint32_t first ;
+} shard_t ;
+
+struct chip8_env {
+    uint32_t n_envs ;
+    uint32_t n_shards ;
+    uint32_t instructions_per_frame ;
+    chip8_env_options_t opts ;
+    config_t config ;
+    chip8_t proto ;           //power on state every env starts from
+    uint8_t *obs ;            //caller's observation buffer
+    shard_t *shards ;
+
+    //worker pool, shard 0 runs on the calling thread
+    pthread_t *threads ;
+    uint32_t n_workers ;      //threads started
+    pthread_mutex_t lock ;
+    pthread_cond_t job_ready ;
+    pthread_cond_t job_done ;
+    uint64_t job ;            //bumped for every step, workers wait for a new value
+    uint32_t pending ;        //shards still busy with the current step
+    bool quit ;
+
+    //current step
+    const uint16_t *actions ;
+    uint32_t frames ;
+    float *rewards ;
+};
+
+//run the current step on one shard
+static void run_shard(shard_t *shard) {
+    chip8_env_t *env = shard -> env ;
+    chip8_batch_t *b = shard -> batch ;
+    const uint16_t addr = env -> opts.reward_addr & 0xFFF ;
+
+    for ( uint32_t l = 0 ; l < b -> n ; l ++) {
+        const uint16_t keys = env -> actions[shard -> first + l] ;
+        for ( uint32_t k = 0 ; k < 16 ; k ++) b -> keypad[l][k] = (keys >> k) & 1 ;
+        env -> rewards[shard -> first + l] = env -> opts.reward_delta ? -(float)b -> ram[l][addr] : 0.0f ;
+    }
+
+    for ( uint32_t f = 0 ; f < env -> frames ; f ++) {
+        chip8_batch_step(b, env -> instructions_per_frame) ;
+        chip8_batch_update_timers(b) ;
+    }
+
+    for ( uint32_t l = 0 ; l < b -> n ; l ++)
+        env -> rewards[shard -> first + l] += b -> ram[l][addr] ;
+}
+
+static void *worker(void *arg) {
+    shard_t *shard = arg ;
+    chip8_env_t *env = shard -> env ;
+    uint64_t seen = 0 ;
+
+    pthread_mutex_lock(&env -> lock) ;
+    for (;;) {
+        while ( !env -> quit && env -> job == seen) pthread_cond_wait(&env -> job_ready, &env -> lock) ;
+        if ( env -> quit) break ;
+        seen = env -> job ;
+        pthread_mutex_unlock(&env -> lock) ;
+
+        run_shard(shard) ;
+
+        pthread_mutex_lock(&env -> lock) ;
+        if ( --env -> pending == 0) pthread_cond_signal(&env -> job_done) ;
+    }
+    pthread_mutex_unlock(&env -> lock) ;
+    return NULL ;
+}
+
+chip8_env_t *chip8_env_create(const char *rom_name, uint32_t n_envs, uint8_t *obs, const chip8_env_options_t *opts) {
+    if ( n_envs == 0 || !obs) return NULL ;
+
+    chip8_env_t *env = calloc(1, sizeof *env) ;
+    if ( !env) return NULL ;
+    pthread_mutex_init(&env -> lock, NULL) ;
+    pthread_cond_init(&env -> job_ready, NULL) ;
+    pthread_cond_init(&env -> job_done, NULL) ;
+
+    if ( opts) env -> opts = *opts ;
+    if ( env -> opts.threads == 0) env -> opts.threads = 1 ;
+    if ( env -> opts.clock_rate == 0) env -> opts.clock_rate = 700 ;
+
+    env -> n_envs = n_envs ;
+    env -> obs = obs ;
+    env -> instructions_per_frame = env -> opts.clock_rate / 60 ;
+    env -> config = (config_t) {
+        .window_width = 64 ,
+        .window_height = 32 ,
+        .clock_rate = env -> opts.clock_rate ,
+        .quirks = env -> opts.quirks < PROFILE_COUNT ? env -> opts.quirks : PROFILE_MODERN ,
+    } ;
+
+    //split envs evenly, never more shards than envs
+    const uint32_t n_shards = env -> opts.threads < n_envs ? env -> opts.threads : n_envs ;
+    env -> shards = calloc(n_shards, sizeof *env -> shards) ;
+    env -> threads = calloc(n_shards, sizeof *env -> threads) ;
+    if ( !env -> shards || !env -> threads || !init_chip8(&env -> proto, rom_name)) {
+        chip8_env_destroy(env) ;
+        return NULL ;
+    }
+    env -> n_shards = n_shards ;
+
+    bool (*display)[CHIP8_ENV_OBS_SIZE] = (bool (*)[CHIP8_ENV_OBS_SIZE])obs ;
+    uint32_t first = 0 ;
+    for ( uint32_t s = 0 ; s < env -> n_shards ; s ++) {
+        const uint32_t count = n_envs / env -> n_shards + (s < n_envs % env -> n_shards) ;
+        env -> shards[s] = (shard_t) { .env = env, .first = first } ;
+        env -> shards[s].batch = chip8_batch_create(&env -> proto, env -> config, count, env -> opts.seed + first, display + first) ;
+        if ( !env -> shards[s].batch) {
+            chip8_env_destroy(env) ;
+            return NULL ;
+        }
+        first += count ;
+    }
+
+    for ( uint32_t s = 1 ; s < env -> n_shards ; s ++) {
+        if ( pthread_create(&env -> threads[s], NULL, worker, &env -> shards[s]) != 0) {
+            chip8_env_destroy(env) ; //stops the workers started so far
+            return NULL ;
+        }
+        env -> n_workers = s ;
+    }
+
+    chip8_env_reset(env, NULL) ;
+    return env ;
+}
+
+void chip8_env_destroy(chip8_env_t *env) {
+    if ( !env) return ;
+
+    pthread_mutex_lock(&env -> lock) ;
+    env -> quit = true ;
+    pthread_cond_broadcast(&env -> job_ready) ;
+    pthread_mutex_unlock(&env -> lock) ;
+    for ( uint32_t s = 1 ; s <= env -> n_workers ; s ++) pthread_join(env -> threads[s], NULL) ;
+    free(env -> threads) ;
+    pthread_mutex_destroy(&env -> lock) ;
+    pthread_cond_destroy(&env -> job_ready) ;
+    pthread_cond_destroy(&env -> job_done) ;
+
+    for ( uint32_t s = 0 ; s < env -> n_shards ; s ++) chip8_batch_destroy(env -> shards[s].batch) ;
+    free(env -> shards) ;
+    free(env) ;
+}
+
+void chip8_env_reset(chip8_env_t *env, const uint8_t *mask) {
+    //workers are idle between steps, lanes can be touched directly
+    for ( uint32_t s = 0 ; s < env -> n_shards ; s ++) {
+        shard_t *shard = &env -> shards[s] ;
+        for ( uint32_t l = 0 ; l < shard -> batch -> n ; l ++)
+            if ( !mask || mask[shard -> first + l]) chip8_batch_load_lane(shard -> batch, l, &env -> proto) ;
+    }
+}
+
+void chip8_env_step(chip8_env_t *env, const uint16_t *actions, uint32_t frames_per_step, float *rewards) {
+    env -> actions = actions ;
+    env -> frames = frames_per_step ;
+    env -> rewards = rewards ;
+
+    //hand shards 1.. to the workers, shard 0 runs here
+    pthread_mutex_lock(&env -> lock) ;
+    env -> pending = env -> n_shards - 1 ;
+    env -> job ++ ;
+    pthread_cond_broadcast(&env -> job_ready) ;
+    pthread_mutex_unlock(&env -> lock) ;
+
+    run_shard(&env -> shards[0]) ;
+
+    pthread_mutex_lock(&env -> lock) ;
+    while ( env -> pending > 0) pthread_cond_wait(&env -> job_done, &env -> lock) ;
+    pthread_mutex_unlock(&env -> lock) ;
+}
@@ -0,0 +1,40 @@
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+//vectorized reinforcement learning environment around the core
+//n_envs copies of one ROM, stepped in parallel by worker threads on top of
+//the batch engine, no SDL
+//observations: the caller owns one contiguous buffer of n_envs*CHIP8_ENV_OBS_SIZE
+//bytes (one byte per pixel, 0 or 1, row major) and the machines draw straight into it
+
+#define CHIP8_ENV_OBS_SIZE (64*32)
+
+typedef struct chip8_env chip8_env_t ;
+
+typedef struct {
+    uint32_t threads ;        //worker threads, 0 = 1
+    uint32_t clock_rate ;     //instructions per second, 0 = 700 like the frontend
+    uint16_t reward_addr ;    //RAM address the reward is read from
+    bool reward_delta ;       //reward is the change of ram[reward_addr] over the step instead of its value
+    uint32_t seed ;           //seed of the CXNN random generators
+    quirk_profile_t quirks ;  //interpreter variant, PROFILE_MODERN by default
+} chip8_env_options_t ;
+
+//load rom_name into n_envs machines drawing into obs, opts may be NULL for defaults
+//returns NULL if the ROM can't be loaded or memory runs out
+chip8_env_t *chip8_env_create(const char *rom_name, uint32_t n_envs, uint8_t *obs, const chip8_env_options_t *opts) ;
+void chip8_env_destroy(chip8_env_t *env) ;
+
+//put every env with mask[i] != 0 back to the power on state, mask NULL resets all
+void chip8_env_reset(chip8_env_t *env, const uint8_t *mask) ;
+
+//hold actions[i] (bitmask of pressed keys 0x0-0xF) on env i for frames_per_step 60Hz frames
+//rewards[i] receives the reward of env i, obs holds the frame at the end of the step
+void chip8_env_step(chip8_env_t *env, const uint16_t *actions, uint32_t frames_per_step, float *rewards) ;
+
+#endif //CHIP8_ENV_H
@@ -0,0 +1,226 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8_explore.h"
+
+//one state of the search
+typedef struct {
+    uint32_t parent ;         //index in the previous level
+    uint16_t input ;          //keypad held for the frame that led here
+    bool goal ;
+    chip8_fork_t m ;
+} node_t ;
+
+//growable list of nodes, one per worker while a level is expanded
+typedef struct {
+    node_t *nodes ;
+    uint32_t n ;
+    uint32_t cap ;
+} level_t ;
+
+//how each state of a level was reached, kept after its machines are freed to rebuild the path
+typedef struct {
+    uint32_t parent ;
+    uint16_t input ;
+} trail_t ;
+
+typedef struct {
+    config_t config ;
+    const explore_options_t *opts ;
+    const uint16_t *inputs ;
+    uint32_t n_inputs ;
+    uint32_t instructions_per_frame ;
+
+    const node_t *frontier ;  //level being expanded
+    uint32_t n_frontier ;
+    atomic_uint next ;        //next frontier node to hand out
+
+    //seen states, open addressing on the state hash, 0 marks a free slot
+    _Atomic uint64_t *seen ;
+    uint64_t seen_mask ;
+    atomic_uint_fast64_t n_seen ;
+    atomic_uint_fast64_t duplicates ;
+    atomic_bool stop ;        //out of memory or out of states
+} search_t ;
+
+typedef struct {
+    search_t *search ;
+    level_t out ;             //children this worker kept
+} worker_t ;
+
+//false if hash was already in the set, lock free so every worker can insert
+static bool seen_insert(search_t *s , uint64_t hash) {
+    if ( hash == 0) hash = 1 ;
+    for ( uint64_t i = hash & s -> seen_mask ;; i = (i + 1) & s -> seen_mask) {
+        uint64_t cur = atomic_load_explicit(&s -> seen[i], memory_order_relaxed) ;
+        if ( cur == 0 && atomic_compare_exchange_strong(&s -> seen[i], &cur, hash)) {
+            if ( atomic_fetch_add(&s -> n_seen, 1) + 1 >= s -> opts -> max_states) atomic_store(&s -> stop, true) ;
+            return true ;
+        }
+        if ( cur == hash) return false ;
+    }
+}
+
+static bool level_push(level_t *level , const node_t *node) {
+    if ( level -> n == level -> cap) {
+        const uint32_t cap = level -> cap ? level -> cap * 2 : 256 ;
+        node_t *nodes = realloc(level -> nodes, cap * sizeof *nodes) ;
+        if ( !nodes) return false ;
+        level -> nodes = nodes ;
+        level -> cap = cap ;
+    }
+    level -> nodes[level -> n ++] = *node ;
+    return true ;
+}
+
+static void level_free(level_t *level) {
+    for ( uint32_t i = 0 ; i < level -> n ; i ++) chip8_fork_free(&level -> nodes[i].m) ;
+    free(level -> nodes) ;
+    *level = (level_t) {0} ;
+}
+
+//fork every frontier node handed to this worker once per input and run one frame on each child
+static void *expand(void *arg) {
+    worker_t *w = arg ;
+    search_t *s = w -> search ;
+
+    for (;;) {
+        const uint32_t i = atomic_fetch_add(&s -> next, 1) ;
+        if ( i >= s -> n_frontier || atomic_load_explicit(&s -> stop, memory_order_relaxed)) break ;
+
+        for ( uint32_t k = 0 ; k < s -> n_inputs ; k ++) {
+            node_t child = { .parent = i, .input = s -> inputs[k] } ;
+            chip8_fork(&child.m, &s -> frontier[i].m) ;
+            child.m.keypad = child.input ;
+            chip8_fork_run(&child.m, s -> config, s -> instructions_per_frame) ;
+            chip8_fork_tick_timers(&child.m) ;
+
+            if ( child.m.failed) {
+                atomic_store(&s -> stop, true) ;
+                chip8_fork_free(&child.m) ;
+                break ;
+            }
+            if ( !seen_insert(s, chip8_fork_hash(&child.m))) {
+                atomic_fetch_add_explicit(&s -> duplicates, 1, memory_order_relaxed) ;
+                chip8_fork_free(&child.m) ;
+                continue ;
+            }
+            child.goal = s -> opts -> goal && s -> opts -> goal(&child.m, s -> opts -> user) ;
+            if ( !level_push(&w -> out, &child)) {
+                atomic_store(&s -> stop, true) ;
+                chip8_fork_free(&child.m) ;
+                break ;
+            }
+        }
+    }
+    return NULL ;
+}
+
+int32_t chip8_explore(const chip8_t *start , const config_t config , const explore_options_t *opts , uint16_t *path , explore_stats_t *stats) {
+    //nothing held, then every key on its own
+    static const uint16_t single_keys[17] = {
+        0, 1 << 0x0, 1 << 0x1, 1 << 0x2, 1 << 0x3, 1 << 0x4, 1 << 0x5, 1 << 0x6, 1 << 0x7,
+        1 << 0x8, 1 << 0x9, 1 << 0xA, 1 << 0xB, 1 << 0xC, 1 << 0xD, 1 << 0xE, 1 << 0xF,
+    } ;
+
+    explore_options_t defaults = *opts ;
+    if ( defaults.threads == 0) defaults.threads = 1 ;
+    if ( defaults.max_states == 0) defaults.max_states = 1 << 20 ;
+
+    search_t s = {
+        .config = config ,
+        .opts = &defaults ,
+        .inputs = opts -> inputs ? opts -> inputs : single_keys ,
+        .n_inputs = opts -> inputs ? opts -> n_inputs : 17 ,
+        .instructions_per_frame = config.clock_rate / 60 ,
+    } ;
+    if ( config.quirks >= PROFILE_COUNT) s.config.quirks = PROFILE_MODERN ;
+    if ( stats) *stats = (explore_stats_t) {0} ;
+
+    //hash set at most half full
+    uint64_t slots = 1024 ;
+    while ( slots < 2ull * defaults.max_states) slots *= 2 ;
+    s.seen = calloc(slots, sizeof *s.seen) ;
+    s.seen_mask = slots - 1 ;
+
+    trail_t **trails = calloc(defaults.max_depth + 1, sizeof *trails) ;
+    worker_t *workers = calloc(defaults.threads, sizeof *workers) ;
+    pthread_t *threads = calloc(defaults.threads, sizeof *threads) ;
+    bool *started = calloc(defaults.threads, sizeof *started) ;
+    level_t frontier = {0} ;
+    node_t root = {0} ;
+    int32_t found = -1 ;
+
+    if ( !s.seen || !trails || !workers || !threads || !started || !chip8_fork_init(&root.m, start, defaults.seed)) goto done ;
+    seen_insert(&s, chip8_fork_hash(&root.m)) ;
+    if ( defaults.goal && defaults.goal(&root.m, defaults.user)) {
+        chip8_fork_free(&root.m) ;
+        found = 0 ;
+        goto done ;
+    }
+    if ( !level_push(&frontier, &root)) {
+        chip8_fork_free(&root.m) ;
+        goto done ;
+    }
+
+    for ( uint32_t depth = 1 ; depth <= defaults.max_depth && frontier.n > 0 && !atomic_load(&s.stop) ; depth ++) {
+        s.frontier = frontier.nodes ;
+        s.n_frontier = frontier.n ;
+        atomic_store(&s.next, 0) ;
+
+        //worker 0 runs here, the rest on threads; a thread that fails to start just leaves its share to the others
+        for ( uint32_t t = 0 ; t < defaults.threads ; t ++) workers[t] = (worker_t) { .search = &s } ;
+        for ( uint32_t t = 1 ; t < defaults.threads ; t ++) started[t] = pthread_create(&threads[t], NULL, expand, &workers[t]) == 0 ;
+        expand(&workers[0]) ;
+        for ( uint32_t t = 1 ; t < defaults.threads ; t ++) if ( started[t]) pthread_join(threads[t], NULL) ;
+
+        //the expanded level is no longer needed, its children become the next frontier
+        level_free(&frontier) ;
+        uint32_t total = 0 ;
+        for ( uint32_t t = 0 ; t < defaults.threads ; t ++) total += workers[t].out.n ;
+        frontier.nodes = malloc((total ? total : 1) * sizeof *frontier.nodes) ;
+        trails[depth] = malloc((total ? total : 1) * sizeof *trails[depth]) ;
+        if ( !frontier.nodes || !trails[depth]) {
+            for ( uint32_t t = 0 ; t < defaults.threads ; t ++) level_free(&workers[t].out) ;
+            goto done ;
+        }
+        frontier.cap = total ;
+        for ( uint32_t t = 0 ; t < defaults.threads ; t ++) {
+            if ( workers[t].out.n) memcpy(&frontier.nodes[frontier.n], workers[t].out.nodes, workers[t].out.n * sizeof *frontier.nodes) ;
+            frontier.n += workers[t].out.n ;
+            free(workers[t].out.nodes) ;
+        }
+        for ( uint32_t i = 0 ; i < frontier.n ; i ++)
+            trails[depth][i] = (trail_t) { .parent = frontier.nodes[i].parent, .input = frontier.nodes[i].input } ;
+        if ( stats) stats -> depth = depth ;
+
+        //shortest path: walk the trails back from the first goal state of this level
+        for ( uint32_t i = 0 ; i < frontier.n ; i ++) {
+            if ( !frontier.nodes[i].goal) continue ;
+            uint32_t node = i ;
+            for ( uint32_t d = depth ; d >= 1 ; d --) {
+                if ( path) path[d - 1] = trails[d][node].input ;
+                node = trails[d][node].parent ;
+            }
+            found = depth ;
+            break ;
+        }
+        if ( found >= 0) break ;
+    }
+
+done:
+    if ( stats) {
+        stats -> states = atomic_load(&s.n_seen) ;
+        stats -> duplicates = atomic_load(&s.duplicates) ;
+    }
+    level_free(&frontier) ;
+    if ( trails) for ( uint32_t d = 0 ; d <= defaults.max_depth ; d ++) free(trails[d]) ;
+    free(trails) ;
+    free(workers) ;
+    free(threads) ;
+    free(started) ;
+    free(s.seen) ;
+    return found ;
+}
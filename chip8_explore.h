@@ -0,0 +1,34 @@
+#ifndef CHIP8_EXPLORE_H
+#define CHIP8_EXPLORE_H
+
+#include "chip8_fork.h"
+
+//parallel breadth first search over keypad inputs, for bots and tool assisted testing
+//every state of one depth is forked once per input, the input is held for one 60Hz
+//frame, and children whose state hash was already seen are dropped
+//forks share RAM and display chunks with their parent (chip8_fork.h), so a level costs
+//a few hundred bytes per state plus the chunks its frame actually wrote
+
+typedef struct {
+    uint32_t threads ;        //worker threads, 0 = 1
+    uint32_t max_depth ;      //frames to search
+    uint32_t max_states ;     //distinct states to keep before giving up, 0 = 1 << 20
+    const uint16_t *inputs ;  //keypad bitmasks tried every frame, NULL = nothing held and each single key
+    uint32_t n_inputs ;
+    uint32_t seed ;           //seed of the CXNN random generator
+    bool (*goal)(const chip8_fork_t *m , void *user) ; //search target, called once per new state
+    void *user ;
+} explore_options_t ;
+
+typedef struct {
+    uint64_t states ;         //distinct states reached
+    uint64_t duplicates ;     //children dropped because their state was seen before
+    uint32_t depth ;          //deepest level expanded
+} explore_stats_t ;
+
+//search from start (set up by init_chip8) with config's clock rate and quirk profile
+//returns the length of the shortest input sequence reaching goal and writes it to path
+//(max_depth entries), -1 if there is none within the limits or memory ran out
+int32_t chip8_explore(const chip8_t *start , const config_t config , const explore_options_t *opts , uint16_t *path , explore_stats_t *stats) ;
+
+#endif //CHIP8_EXPLORE_H
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8_fork.h"
+#include "chip8_hash.h"
+
+static chunk_t *chunk_new(const uint8_t *data) {
+    chunk_t *c = malloc(sizeof *c) ;
+    if ( !c) return NULL ;
+    atomic_init(&c -> refs, 1) ;
+    if ( data) memcpy(c -> data, data, CHUNK_SIZE) ;
+    else memset(c -> data, 0, CHUNK_SIZE) ;
+    return c ;
+}
+
+static void chunk_release(chunk_t *c) {
+    if ( c && atomic_fetch_sub_explicit(&c -> refs, 1, memory_order_acq_rel) == 1) free(c) ;
+}
+
+//make *slot private to this machine before it is written
+//refs == 1 means no other machine can see the chunk, so no other thread can raise it either
+static uint8_t *chunk_writable(chip8_fork_t *m , chunk_t **slot , uint32_t offset) {
+    chunk_t *c = *slot ;
+    if ( atomic_load_explicit(&c -> refs, memory_order_acquire) > 1) {
+        chunk_t *copy = chunk_new(c -> data) ;
+        if ( !copy) {
+            m -> failed = true ;
+            return &m -> scratch ;
+        }
+        chunk_release(c) ;
+        *slot = c = copy ;
+    }
+    return &c -> data[offset] ;
+}
+
+//RAM write keeping ram_hash up to date
+static inline void ram_write(chip8_fork_t *m , uint16_t addr , uint8_t value) {
+    uint8_t *cell = chunk_writable(m, &m -> ram[(addr >> 8) & (RAM_CHUNKS - 1)], addr & (CHUNK_SIZE - 1)) ;
+    m -> ram_hash ^= hash_ram_cell(addr, *cell) ^ hash_ram_cell(addr, value) ;
+    *cell = value ;
+}
+
+//all zero chunk every cleared display points at, 00E0 then copies nothing
+//the static holds one reference of its own, so refs is > 1 whenever a machine sees
+//it (a write copies it first) and never drops to 0 (it is never freed)
+static chunk_t zero_chunk = { .refs = 1 } ;
+
+static void display_clear(chip8_fork_t *m) {
+    m -> disp_hash = 0 ;
+    for ( uint32_t i = 0 ; i < DISP_CHUNKS ; i ++) {
+        if ( m -> display[i] == &zero_chunk) continue ;
+        atomic_fetch_add_explicit(&zero_chunk.refs, 1, memory_order_relaxed) ;
+        chunk_release(m -> display[i]) ;
+        m -> display[i] = &zero_chunk ;
+    }
+}
+
+
+//emulate_instruction() on a forkable machine, one instantiation per quirk profile
+#define EXEC_PARAMS      chip8_fork_t *m, const config_t *config
+#define EX_INST          m -> inst
+#define EX_V(r)          m -> V[r]
+#define EX_I             m -> I
+#define EX_PC            m -> PC
+#define EX_DT            m -> delay_timer
+#define EX_ST            m -> sound_timer
+#define EX_RAM(a)        chip8_fork_ram(m, a)
+#define EX_RAM_WR(a, v)  ram_write(m, a, v)
+#define EX_DISP(i)       chip8_fork_pixel(m, i)
+#define EX_DISP_FLIP(i)  (m -> disp_hash ^= hash_pixel(i), *chunk_writable(m, &m -> display[(i) / CHUNK_SIZE], (i) % CHUNK_SIZE) ^= 1)
+#define EX_DISP_CLEAR()  display_clear(m)
+#define EX_PUSH(a)       (m -> stack[m -> sp++ % STACK_DEPTH] = (a))
+#define EX_POP()         (m -> stack[--m -> sp % STACK_DEPTH])
+#define EX_KEY(k)        ((m -> keypad >> ((k) & 0xF)) & 1)
+#define EX_RAND()        xorshift32(&m -> rng)
+#define EX_W             config -> window_width
+#define EX_H             config -> window_height
+#define EX_TRACE()       (void)0
+#define EX_WATCH(a, n, kind) (void)0
+#define EX_AUDIO_PATTERN(a) (void)0   //no audio output, and the program can't read it back
+#define EX_AUDIO_PITCH(v)   (void)0
+
+#define EXEC_NAME exec_fork_modern
+#define EX_QUIRKS QUIRKS_MODERN
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_fork_vip
+#define EX_QUIRKS QUIRKS_VIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_fork_schip
+#define EX_QUIRKS QUIRKS_SCHIP
+#include "chip8_exec.inc"
+
+#define EXEC_NAME exec_fork_xochip
+#define EX_QUIRKS QUIRKS_XOCHIP
+#include "chip8_exec.inc"
+
+#define RUN_LOOP(name, exec)                                                            \
+    static uint32_t name(chip8_fork_t *m, const config_t *config, uint32_t count) {     \
+        for ( uint32_t i = 0 ; i < count ; i ++)                                        \
+            if ( !exec(m, config)) return i + 1 ;                                       \
+        return count ;                                                                  \
+    }
+RUN_LOOP(run_fork_modern, exec_fork_modern)
+RUN_LOOP(run_fork_vip, exec_fork_vip)
+RUN_LOOP(run_fork_schip, exec_fork_schip)
+RUN_LOOP(run_fork_xochip, exec_fork_xochip)
+
+static uint32_t (*const run_fork_table[PROFILE_COUNT])(chip8_fork_t *, const config_t *, uint32_t) = {
+    [PROFILE_MODERN] = run_fork_modern,
+    [PROFILE_VIP]    = run_fork_vip,
+    [PROFILE_SCHIP]  = run_fork_schip,
+    [PROFILE_XOCHIP] = run_fork_xochip,
+} ;
+
+bool chip8_fork_init(chip8_fork_t *m , const chip8_t *chip8 , uint32_t seed) {
+    memset(m, 0, sizeof *m) ;
+    for ( uint32_t i = 0 ; i < RAM_CHUNKS ; i ++)
+        if ( !(m -> ram[i] = chunk_new(&chip8 -> ram[i*CHUNK_SIZE]))) goto fail ;
+    for ( uint32_t i = 0 ; i < DISP_CHUNKS ; i ++)
+        if ( !(m -> display[i] = chunk_new((const uint8_t *)&chip8 -> display[i*CHUNK_SIZE]))) goto fail ;
+
+    memcpy(m -> V, chip8 -> V, sizeof m -> V) ;
+    m -> I = chip8 -> I ;
+    m -> PC = chip8 -> PC ;
+    memcpy(m -> stack, chip8 -> stack, sizeof chip8 -> stack) ;
+    m -> sp = chip8 -> stack_top ? (uint8_t)(chip8 -> stack_top - chip8 -> stack) : 0 ;
+    m -> delay_timer = chip8 -> delay_timer ;
+    m -> sound_timer = chip8 -> sound_timer ;
+    for ( uint32_t k = 0 ; k < 16 ; k ++) m -> keypad |= chip8 -> keypad[k] << k ;
+    m -> rng = xorshift_seed(seed) ;
+    m -> ram_hash = hash_ram(chip8 -> ram) ;
+    m -> disp_hash = hash_display((const uint8_t *)chip8 -> display, sizeof chip8 -> display) ;
+    return true ;
+
+fail:
+    chip8_fork_free(m) ;
+    return false ;
+}
+
+void chip8_fork_free(chip8_fork_t *m) {
+    for ( uint32_t i = 0 ; i < RAM_CHUNKS ; i ++) chunk_release(m -> ram[i]) ;
+    for ( uint32_t i = 0 ; i < DISP_CHUNKS ; i ++) chunk_release(m -> display[i]) ;
+    memset(m, 0, sizeof *m) ;
+}
+
+void chip8_fork(chip8_fork_t *child , const chip8_fork_t *parent) {
+    *child = *parent ;
+    for ( uint32_t i = 0 ; i < RAM_CHUNKS ; i ++) atomic_fetch_add_explicit(&child -> ram[i] -> refs, 1, memory_order_relaxed) ;
+    for ( uint32_t i = 0 ; i < DISP_CHUNKS ; i ++) atomic_fetch_add_explicit(&child -> display[i] -> refs, 1, memory_order_relaxed) ;
+}
+
+void chip8_fork_store(const chip8_fork_t *m , chip8_t *chip8) {
+    for ( uint32_t i = 0 ; i < RAM_CHUNKS ; i ++) memcpy(&chip8 -> ram[i*CHUNK_SIZE], m -> ram[i] -> data, CHUNK_SIZE) ;
+    for ( uint32_t i = 0 ; i < DISP_CHUNKS ; i ++) memcpy(&chip8 -> display[i*CHUNK_SIZE], m -> display[i] -> data, CHUNK_SIZE) ;
+    memcpy(chip8 -> V, m -> V, sizeof chip8 -> V) ;
+    chip8 -> I = m -> I ;
+    chip8 -> PC = m -> PC ;
+    memcpy(chip8 -> stack, m -> stack, sizeof chip8 -> stack) ;
+    chip8 -> stack_top = chip8 -> stack + m -> sp % STACK_DEPTH ;
+    chip8 -> delay_timer = m -> delay_timer ;
+    chip8 -> sound_timer = m -> sound_timer ;
+    for ( uint32_t k = 0 ; k < 16 ; k ++) chip8 -> keypad[k] = (m -> keypad >> k) & 1 ;
+    chip8 -> ram_hash = m -> ram_hash ;
+    chip8 -> disp_hash = m -> disp_hash ;
+}
+
+uint32_t chip8_fork_run(chip8_fork_t *m , const config_t config , uint32_t count) {
+    return run_fork_table[config.quirks](m, &config, count) ;
+}
+
+void chip8_fork_tick_timers(chip8_fork_t *m) {
+    if ( m -> delay_timer > 0) m -> delay_timer -- ;
+    if ( m -> sound_timer > 0) m -> sound_timer -- ;
+}
+
+uint64_t chip8_fork_hash(const chip8_fork_t *m) {
+    //the CXNN generator is part of the state here: two forks only behave the same if it matches too
+    const uint32_t depth = m -> sp < STACK_DEPTH ? m -> sp : STACK_DEPTH ;
+    return hash_mix64(hash_fold(m -> ram_hash, m -> disp_hash, m -> V, m -> I, m -> PC, m -> stack, depth,
+                                m -> delay_timer, m -> sound_timer) ^ m -> rng) ;
+}
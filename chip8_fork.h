@@ -0,0 +1,70 @@
+#ifndef CHIP8_FORK_H
+#define CHIP8_FORK_H
+
+#include <stdatomic.h>
+
+#include "chip8.h"
+
+//forkable machine: RAM and display live in refcounted 256 byte chunks shared
+//between a machine and its forks, a chunk is copied the first time a fork
+//writes to it (FX33, FX55, DXYN, 00E0), so forking costs a few hundred bytes
+//instead of 6KB and untouched chunks (font, ROM code) are never duplicated
+//chunks may be shared across threads, every machine must only be run by one thread at a time
+
+#define CHUNK_SIZE   256
+#define RAM_CHUNKS   (4096 / CHUNK_SIZE)
+#define DISP_CHUNKS  (64*32 / CHUNK_SIZE)
+
+typedef struct {
+    atomic_uint refs ;        //machines pointing at this chunk
+    uint8_t data[CHUNK_SIZE] ;
+} chunk_t ;
+
+typedef struct {
+    chunk_t *ram[RAM_CHUNKS] ;
+    chunk_t *display[DISP_CHUNKS] ; //one byte per pixel, 0 or 1
+    uint8_t V[16] ;
+    uint16_t I ;
+    uint16_t PC ;
+    uint16_t stack[STACK_DEPTH] ;
+    uint8_t sp ;              //stack depth, wrapped to STACK_DEPTH entries
+    uint8_t delay_timer ;
+    uint8_t sound_timer ;
+    uint16_t keypad ;         //bit k set: key k held
+    uint32_t rng ;            //xorshift state for CXNN, part of the state so forks replay identically
+    instruction_t inst ;
+    uint64_t ram_hash ;       //incremental RAM and display hashes, see chip8_hash.h
+    uint64_t disp_hash ;
+    bool failed ;             //a chunk copy ran out of memory, the machine state is no longer valid
+    uint8_t scratch ;         //write target while failed
+} chip8_fork_t ;
+
+//new machine holding a copy of chip8 (set up by init_chip8), false if out of memory
+bool chip8_fork_init(chip8_fork_t *m , const chip8_t *chip8 , uint32_t seed) ;
+void chip8_fork_free(chip8_fork_t *m) ;
+
+//child shares every chunk of parent, never fails
+void chip8_fork(chip8_fork_t *child , const chip8_fork_t *parent) ;
+
+//copy the machine back into a plain chip8_t
+void chip8_fork_store(const chip8_fork_t *m , chip8_t *chip8) ;
+
+//emulate up to count instructions with the config's quirk profile, stops early on a display wait
+uint32_t chip8_fork_run(chip8_fork_t *m , const config_t config , uint32_t count) ;
+
+//60Hz tick of delay and sound timers
+void chip8_fork_tick_timers(chip8_fork_t *m) ;
+
+//hash of the machine state, everything but the keypad (that is input, not state)
+//chip8_hash() of the stored machine mixed with the CXNN generator, incremental as well
+uint64_t chip8_fork_hash(const chip8_fork_t *m) ;
+
+//machine bytes read through the chunks
+static inline uint8_t chip8_fork_ram(const chip8_fork_t *m , uint16_t addr) {
+    return m -> ram[(addr >> 8) & (RAM_CHUNKS - 1)] -> data[addr & (CHUNK_SIZE - 1)] ;
+}
+static inline bool chip8_fork_pixel(const chip8_fork_t *m , uint32_t i) {
+    return m -> display[i / CHUNK_SIZE] -> data[i % CHUNK_SIZE] ;
+}
+
+#endif //CHIP8_FORK_H
@@ -0,0 +1,58 @@
+#ifndef CHIP8_HASH_H
+#define CHIP8_HASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+//incremental machine state hash
+//RAM and display hashes are XORs of one term per byte / lit pixel, so a write only
+//swaps the old term for the new one instead of rehashing 6KB; registers, stack and
+//timers are small and folded in when the hash is read
+
+//splitmix64 finalizer
+static inline uint64_t hash_mix64(uint64_t x) {
+    x ^= x >> 30 ;
+    x *= 0xBF58476D1CE4E5B9ull ;
+    x ^= x >> 27 ;
+    x *= 0x94D049BB133111EBull ;
+    return x ^ (x >> 31) ;
+}
+
+//term of RAM byte addr holding value
+static inline uint64_t hash_ram_cell(uint32_t addr , uint8_t value) {
+    return hash_mix64((uint64_t)(addr & 0xFFF) << 8 | value) ;
+}
+
+//term of lit pixel i, unlit pixels add nothing so a clear screen hashes to 0
+static inline uint64_t hash_pixel(uint32_t i) {
+    return hash_mix64(0x100000ull + i) ;
+}
+
+//full RAM / display hashes, for loading a machine or after it was changed behind the hash's back
+static inline uint64_t hash_ram(const uint8_t *ram) {
+    uint64_t h = 0 ;
+    for ( uint32_t a = 0 ; a < 4096 ; a ++) h ^= hash_ram_cell(a, ram[a]) ;
+    return h ;
+}
+static inline uint64_t hash_display(const uint8_t *display , uint32_t n) {
+    uint64_t h = 0 ;
+    for ( uint32_t i = 0 ; i < n ; i ++) if ( display[i]) h ^= hash_pixel(i) ;
+    return h ;
+}
+
+//fold the registers into the RAM and display hashes, stack entries above the depth are ignored
+static inline uint64_t hash_fold(uint64_t ram_hash , uint64_t disp_hash , const uint8_t V[16] , uint16_t I , uint16_t PC ,
+                                 const uint16_t *stack , uint32_t depth , uint8_t delay_timer , uint8_t sound_timer) {
+    uint64_t v0 , v1 ;
+    memcpy(&v0, &V[0], 8) ;
+    memcpy(&v1, &V[8], 8) ;
+    uint64_t h = hash_mix64(ram_hash ^ hash_mix64(disp_hash + 1)) ;
+    h = hash_mix64(h ^ v0) ;
+    h = hash_mix64(h ^ v1) ;
+    h = hash_mix64(h ^ ((uint64_t)I << 32 | (uint64_t)PC << 16 | (uint64_t)delay_timer << 8 | sound_timer)) ;
+    h = hash_mix64(h ^ depth) ;
+    for ( uint32_t d = 0 ; d < depth ; d ++) h = hash_mix64(h ^ stack[d]) ;
+    return h ;
+}
+
+#endif //CHIP8_HASH_H
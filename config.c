@@ -0,0 +1,355 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "config.h"
+
+//options without a value on the command line, true/false in the file
+static const char *const flag_options[] = {
+    "host-refresh", "vsync", "hud", "debug", "no-outlines", "outlines", "scanlines",
+} ;
+
+static bool is_flag(const char *key) {
+    for ( size_t i = 0 ; i < sizeof flag_options / sizeof *flag_options ; i ++)
+        if ( strcmp(key, flag_options[i]) == 0) return true ;
+    return false ;
+}
+
+//value as an unsigned decimal number in [min, max], leading zeros are not octal
+static bool parse_uint(const char *value , uint32_t min , uint32_t max , uint32_t *out) {
+    if ( !value || !isdigit((unsigned char)*value)) return false ;
+    char *end ;
+    errno = 0 ;
+    const unsigned long n = strtoul(value, &end, 10) ;
+    if ( errno || *end || n < min || n > max) return false ;
+    *out = (uint32_t)n ;
+    return true ;
+}
+
+//value as a flag, a missing value (bare command line flag) is true
+static bool parse_bool(const char *value , bool *out) {
+    if ( !value) {
+        *out = true ;
+        return true ;
+    }
+    static const char *const yes[] = { "true", "yes", "on", "1" } ;
+    static const char *const no[] = { "false", "no", "off", "0" } ;
+    for ( size_t i = 0 ; i < 4 ; i ++) {
+        if ( strcmp(value, yes[i]) == 0) { *out = true ; return true ; }
+        if ( strcmp(value, no[i]) == 0) { *out = false ; return true ; }
+    }
+    return false ;
+}
+
+static bool copy_path(char *dst , const char *value) {
+    if ( !value || strlen(value) >= CONFIG_PATH_MAX) return false ;
+    strcpy(dst, value) ;
+    return true ;
+}
+
+bool config_set(config_t *config , const char *key , const char *value) {
+    uint32_t n ;
+    bool b ;
+
+    if ( is_flag(key)) {
+        if ( !parse_bool(value, &b)) {
+            SDL_Log("Invalid value %s for %s, expected true or false\n", value, key) ;
+            return false ;
+        }
+        if ( strcmp(key, "host-refresh") == 0) config -> host_refresh_render = b ;
+        else if ( strcmp(key, "vsync") == 0) config -> vsync = b ;
+        else if ( strcmp(key, "hud") == 0) config -> show_hud = b ;
+        else if ( strcmp(key, "debug") == 0) config -> start_in_debugger = b ;
+        else if ( strcmp(key, "no-outlines") == 0) config -> pixel_outlines = !b ;
+        else if ( strcmp(key, "outlines") == 0) config -> pixel_outlines = b ;
+        else if ( strcmp(key, "scanlines") == 0) config -> scanlines = b ;
+        return true ;
+    }
+
+    if ( !value) {
+        SDL_Log("Option %s needs a value\n", key) ;
+        return false ;
+    }
+
+    if ( strcmp(key, "frame-skip") == 0) {
+        //frame-skip N presents 1 of every N frames, frame-skip auto drops late presents
+        if ( strcmp(value, "auto") == 0) config -> frame_skip = 0 ;
+        else if ( parse_uint(value, 1, 1000, &n)) config -> frame_skip = n ;
+        else {
+            SDL_Log("Invalid frame skip %s, expected a number >= 1 or auto\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "renderer") == 0) {
+        if ( strcmp(value, "scaler") == 0) config -> renderer = RENDERER_SCALER ;
+        else if ( strcmp(value, "rects") == 0) config -> renderer = RENDERER_RECTS ;
+        else {
+            SDL_Log("Invalid renderer %s, expected scaler or rects\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "quirks") == 0) {
+        //quirks vip|schip|xochip|modern overrides the profile guessed from the ROM
+        if ( !quirks_from_name(value, &config -> quirks)) {
+            SDL_Log("Invalid quirk profile %s, expected modern, vip, schip or xochip\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "clock") == 0) {
+        //instructions per second, at least one per frame
+        if ( !parse_uint(value, 60, 100000000, &config -> clock_rate)) {
+            SDL_Log("Invalid clock rate %s, expected 60-100000000 instructions per second\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "scale") == 0) {
+        if ( !parse_uint(value, 1, 64, &config -> scale_factor)) {
+            SDL_Log("Invalid scale %s, expected 1-64\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "audio-rate") == 0) {
+        if ( !parse_uint(value, 8000, 192000, &config -> audio_sample_rate)) {
+            SDL_Log("Invalid audio sample rate %s, expected 8000-192000 Hz\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "audio-buffer") == 0) {
+        //SDL wants a power of 2
+        if ( !parse_uint(value, 64, 8192, &n) || (n & (n - 1))) {
+            SDL_Log("Invalid audio buffer %s, expected a power of 2 from 64 to 8192 samples\n", value) ;
+            return false ;
+        }
+        config -> audio_buffer = n ;
+    }
+    else if ( strcmp(key, "input-polls") == 0) {
+        //input-polls N also reads input N-1 times inside the frame's instruction batch, for FX0A/EX9E
+        if ( !parse_uint(value, 1, 64, &config -> input_polls)) {
+            SDL_Log("Invalid input poll count %s, expected 1-64\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "phosphor") == 0) {
+        //phosphor N keeps N/256 of a pixel's brightness every emulated frame, hides sprite flicker
+        if ( !parse_uint(value, 0, 255, &n)) {
+            SDL_Log("Invalid phosphor decay %s, expected 0-255\n", value) ;
+            return false ;
+        }
+        config -> phosphor_decay = n ;
+    }
+    else if ( strcmp(key, "headless") == 0) {
+        //headless N runs N frames as fast as possible and prints the chained state hash after each one
+        if ( !parse_uint(value, 1, UINT32_MAX, &config -> headless_frames)) {
+            SDL_Log("Invalid frame count %s, expected a number >= 1\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "seed") == 0) {
+        if ( !parse_uint(value, 0, UINT32_MAX, &config -> rng_seed)) {
+            SDL_Log("Invalid seed %s\n", value) ;
+            return false ;
+        }
+    }
+    else if ( strcmp(key, "metrics") == 0) {
+        //metrics FILE rewrites FILE every second with the performance counters
+        if ( !copy_path(config -> metrics_path, value)) {
+            SDL_Log("Metrics path too long\n") ;
+            return false ;
+        }
+    }
+    else {
+        SDL_Log("Unknown option %s\n", key) ;
+        return false ;
+    }
+    return true ;
+}
+
+//strip leading and trailing blanks in place
+static char *trim(char *s) {
+    while ( isspace((unsigned char)*s)) s ++ ;
+    char *end = s + strlen(s) ;
+    while ( end > s && isspace((unsigned char)end[-1])) *--end = 0 ;
+    return s ;
+}
+
+bool config_load_file(config_t *config , const char *path) {
+    FILE *f = fopen(path, "r") ;
+    if ( !f) {
+        SDL_Log("Could not open config file %s!!! %s\n", path, strerror(errno)) ;
+        return false ;
+    }
+
+    char line[512] ;
+    bool ok = true ;
+    for ( uint32_t number = 1 ; fgets(line, sizeof line, f) ; number ++) {
+        char *hash = strchr(line, '#') ;
+        if ( hash) *hash = 0 ;
+        char *key = trim(line) ;
+        if ( !*key) continue ;
+
+        //"key = value", or a bare "key" for a flag
+        char *value = NULL ;
+        char *eq = strchr(key, '=') ;
+        if ( eq) {
+            *eq = 0 ;
+            value = trim(eq + 1) ;
+            key = trim(key) ;
+        }
+        if ( !config_set(config, key, value)) {
+            SDL_Log("%s:%u: bad setting\n", path, number) ;
+            ok = false ;
+        }
+    }
+    fclose(f) ;
+    return ok ;
+}
+
+bool config_init(config_t *config , int argc , char **argv) {
+    //set deafults
+    *config = (config_t) {
+        .window_width = 64 , //original chip8 x
+        .window_height = 32, //original chip8 y
+        .fg_color = 0xFFFFFFFF, //white
+        .bg_color = 0x0530ADFF, //black
+        .scale_factor = 20, //default size becomes 1280*640
+        .pixel_outlines = true, //default pixel outlines
+        .clock_rate = 700, //default clock rate
+        .square_freq = 440, //440Hz A4
+        .audio_sample_rate = 44100 , //Hz CD quality
+        .audio_buffer = 512, //~12ms at 44100Hz
+        .volume = 3000,    // out of INT16_MAX
+        .frame_skip = 1,   //present every frame
+        .host_refresh_render = false, //present in step with emulation
+        .vsync = false, //present as soon as rendered
+        .input_polls = 1, //input read once per frame, before the batch
+        .renderer = RENDERER_SCALER, //software scaler
+        .scanlines = false, //no scanlines
+        .phosphor_decay = 0, //no phosphor persistence
+        .quirks = quirks_for_rom(argv[1]), //profile from ROM extension
+        .start_in_debugger = false, //run straight away
+        .headless_frames = 0, //open a window
+        .rng_seed = 0, //seed from the clock
+        .metrics_path = "", //no metrics file
+        .show_hud = false, //overlay off until F1
+        .config_path = "", //no config file
+    } ;
+
+    //the config file goes first wherever it is given, so every flag overrides it
+    for ( int i = 2 ; i < argc - 1 ; i ++) {
+        if ( strcmp(argv[i], "--config") != 0) continue ;
+        if ( !copy_path(config -> config_path, argv[i + 1])) {
+            SDL_Log("Config path too long\n") ;
+            return false ;
+        }
+        if ( !config_load_file(config, config -> config_path)) return false ;
+    }
+
+    //override defaults from arguments, argv[1] is the ROM
+    for ( int i = 2 ; i < argc ; i ++) {
+        if ( strncmp(argv[i], "--", 2) != 0) {
+            SDL_Log("Unknown option %s\n", argv[i]) ;
+            return false ;
+        }
+        const char *key = argv[i] + 2 ;
+        if ( strcmp(key, "config") == 0 && i + 1 < argc) {
+            i ++ ; //already loaded
+            continue ;
+        }
+        const char *value = NULL ;
+        if ( !is_flag(key)) {
+            if ( i + 1 >= argc) {
+                SDL_Log("Option %s needs a value\n", argv[i]) ;
+                return false ;
+            }
+            value = argv[++i] ;
+        }
+        if ( !config_set(config, key, value)) return false ;
+    }
+
+    return true ;
+}
+
+bool config_watch_init(config_watch_t *watch , const char *path) {
+    memset(watch, 0, sizeof *watch) ;
+    watch -> fd = -1 ;
+    watch -> wd = -1 ;
+    if ( strlen(path) >= sizeof watch -> path) return false ;
+    strcpy(watch -> path, path) ;
+
+    const char *slash = strrchr(watch -> path, '/') ;
+    watch -> name = slash ? slash + 1 : watch -> path ;
+
+#ifdef __linux__
+    //watch the directory, not the file: editors save by writing a new file and renaming
+    //it over the old one, which would silently end a watch on the file itself
+    //only finished writes count, a file that was just created may still be empty
+    char dir[CONFIG_PATH_MAX] ;
+    if ( slash) snprintf(dir, sizeof dir, "%.*s", (int)(slash - watch -> path) + 1, watch -> path) ;
+    else strcpy(dir, ".") ;
+    watch -> fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC) ;
+    if ( watch -> fd >= 0) {
+        watch -> wd = inotify_add_watch(watch -> fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) ;
+        if ( watch -> wd >= 0) return true ;
+        close(watch -> fd) ;
+        watch -> fd = -1 ;
+    }
+    SDL_Log("Could not watch %s with inotify, polling it instead!!! %s\n", dir, strerror(errno)) ;
+#endif
+
+    struct stat st ;
+    if ( stat(watch -> path, &st) == 0) {
+        watch -> mtime = st.st_mtime ;
+        watch -> size = st.st_size ;
+    }
+    watch -> last_poll = time(NULL) ;
+    return true ;
+}
+
+void config_watch_free(config_watch_t *watch) {
+#ifdef __linux__
+    if ( watch -> fd >= 0) close(watch -> fd) ;
+#endif
+    watch -> fd = -1 ;
+}
+
+bool config_watch_changed(config_watch_t *watch) {
+#ifdef __linux__
+    if ( watch -> fd >= 0) {
+        //drain every pending event, any one naming the file counts
+        _Alignas(struct inotify_event) char buf[4096] ;
+        bool changed = false ;
+        ssize_t len ;
+        while ( (len = read(watch -> fd, buf, sizeof buf)) > 0) {
+            for ( char *p = buf ; p < buf + len ; ) {
+                const struct inotify_event *event = (const struct inotify_event *)p ;
+                if ( event -> len && strcmp(event -> name, watch -> name) == 0) changed = true ;
+                p += sizeof *event + event -> len ;
+            }
+        }
+        return changed ;
+    }
+#endif
+
+    //stat() polling, at most once a second
+    const int64_t now = time(NULL) ;
+    if ( now == watch -> last_poll) return false ;
+    watch -> last_poll = now ;
+
+    struct stat st ;
+    if ( stat(watch -> path, &st) != 0) return false ; //mid replace, try again next second
+    if ( st.st_mtime == watch -> mtime && st.st_size == watch -> size) return false ;
+    watch -> mtime = st.st_mtime ;
+    watch -> size = st.st_size ;
+    return true ;
+}
@@ -0,0 +1,43 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+//configuration from the command line and an optional config file
+//every option has the same name in both places: "--clock 1000" on the command line is
+//"clock = 1000" in the file, flags without a value take true/false there ("vsync = true")
+//the file is applied first so command line flags override it, also on every reload
+//
+//the file can be watched while the emulator runs: inotify on linux, a once a second
+//stat() of the file everywhere else
+
+//build the configuration: defaults, then --config FILE if given, then the flags (argv[1] is the ROM)
+bool config_init(config_t *config , int argc , char **argv) ;
+
+//apply one setting, value is NULL for a command line flag given without one
+bool config_set(config_t *config , const char *key , const char *value) ;
+
+//apply every "key = value" line of a file, # starts a comment
+bool config_load_file(config_t *config , const char *path) ;
+
+//watch on a config file
+typedef struct {
+    char path[CONFIG_PATH_MAX] ;
+    int fd ;                  //inotify descriptor, -1 when stat() polling
+    int wd ;                  //inotify watch on the file's directory
+    const char *name ;        //file name within its directory, points into path
+    int64_t mtime ;           //stat() polling: last seen modification time and size
+    int64_t size ;
+    int64_t last_poll ;       //stat() polling: time() of the last check
+} config_watch_t ;
+
+bool config_watch_init(config_watch_t *watch , const char *path) ;
+void config_watch_free(config_watch_t *watch) ;
+
+//true once after each time the file was written or replaced, never blocks
+bool config_watch_changed(config_watch_t *watch) ;
+
+#endif //CONFIG_H
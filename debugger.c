@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger.h"
+
+//debugger bookkeeping and console prompt, the instrumented loops live in chip8_core.c
+
+static const char *const op_names[] = {
+    [COND_EQ] = "==", [COND_NE] = "!=", [COND_LT] = "<", [COND_GT] = ">", [COND_LE] = "<=", [COND_GE] = ">=",
+} ;
+
+void debugger_init(debugger_t *dbg) {
+    memset(dbg, 0, sizeof *dbg) ;
+}
+
+//recompute the check bitmap, page mask and armed flag after breakpoints or watches changed
+static void rebuild(debugger_t *dbg) {
+    bool any = false ;
+    memcpy(dbg -> check, dbg -> breakpoints, sizeof dbg -> check) ;
+    dbg -> n_global = 0 ;
+    for ( uint32_t c = 0 ; c < dbg -> n_conds ; c ++) {
+        const uint16_t addr = dbg -> conds[c].addr ;
+        if ( addr == DEBUG_ANY_ADDR) dbg -> n_global ++ ;
+        else dbg -> check[addr >> 3] |= 1 << (addr & 7) ;
+    }
+    for ( uint32_t i = 0 ; i < sizeof dbg -> check && !any ; i ++) any = dbg -> check[i] != 0 ;
+
+    dbg -> watch_pages = 0 ;
+    for ( uint32_t w = 0 ; w < dbg -> n_watches ; w ++) {
+        const debug_watch_t *watch = &dbg -> watches[w] ;
+        for ( uint32_t page = watch -> addr >> DEBUG_PAGE_SHIFT ; page <= (uint32_t)(watch -> addr + watch -> len - 1) >> DEBUG_PAGE_SHIFT ; page ++)
+            dbg -> watch_pages |= 1ull << page ;
+    }
+
+    dbg -> armed = any || dbg -> n_global || dbg -> watch_pages || dbg -> until_active ;
+}
+
+//a breakpoint or watchpoint inside a stepped over call ends the step over
+static void cancel_step_over(debugger_t *dbg) {
+    if ( !dbg -> until_active) return ;
+    dbg -> until_active = false ;
+    rebuild(dbg) ;
+}
+
+void debugger_user_break(debugger_t *dbg) {
+    dbg -> reason = BREAK_USER ;
+    dbg -> resume = false ;
+    cancel_step_over(dbg) ;
+}
+
+static uint32_t stack_depth(const chip8_t *chip8) {
+    return (uint32_t)(chip8 -> stack_top - chip8 -> stack) ;
+}
+
+static bool cond_holds(const debug_cond_t *cond , const chip8_t *chip8) {
+    const uint16_t v = cond -> reg == DEBUG_REG_I ? chip8 -> I : chip8 -> V[cond -> reg] ;
+    switch ( cond -> op) {
+        case COND_EQ: return v == cond -> value ;
+        case COND_NE: return v != cond -> value ;
+        case COND_LT: return v <  cond -> value ;
+        case COND_GT: return v >  cond -> value ;
+        case COND_LE: return v <= cond -> value ;
+        case COND_GE: return v >= cond -> value ;
+    }
+    return false ;
+}
+
+bool debugger_check(debugger_t *dbg , const chip8_t *chip8) {
+    const uint16_t pc = chip8 -> PC & 0xFFF ;
+
+    //step over finished: back at the instruction after the call, in the caller's frame
+    if ( dbg -> until_active && pc == dbg -> until_pc && stack_depth(chip8) <= dbg -> until_depth) {
+        dbg -> until_active = false ;
+        rebuild(dbg) ;
+        dbg -> reason = BREAK_STEP ;
+        return true ;
+    }
+
+    if ( (dbg -> breakpoints[pc >> 3] >> (pc & 7)) & 1) {
+        dbg -> reason = BREAK_PC ;
+        cancel_step_over(dbg) ;
+        return true ;
+    }
+
+    for ( uint32_t c = 0 ; c < dbg -> n_conds ; c ++) {
+        debug_cond_t *cond = &dbg -> conds[c] ;
+        bool fire ;
+        if ( cond -> addr == DEBUG_ANY_ADDR) {
+            //anywhere: only the instruction where it becomes true, not every one after
+            const bool holds = cond_holds(cond, chip8) ;
+            fire = holds && !cond -> was_true ;
+            cond -> was_true = holds ;
+        }
+        else fire = cond -> addr == pc && cond_holds(cond, chip8) ;
+
+        if ( fire) {
+            dbg -> reason = BREAK_COND ;
+            dbg -> hit_index = c ;
+            cancel_step_over(dbg) ;
+            return true ;
+        }
+    }
+    return false ;
+}
+
+void debugger_watch_hit(debugger_t *dbg , uint16_t addr , uint16_t len , watch_kind_t kind) {
+    if ( dbg -> reason != BREAK_NONE) return ;
+    for ( uint32_t w = 0 ; w < dbg -> n_watches ; w ++) {
+        const debug_watch_t *watch = &dbg -> watches[w] ;
+        if ( !(watch -> kinds & kind)) continue ;
+        if ( addr < watch -> addr + watch -> len && watch -> addr < addr + len) {
+            dbg -> reason = BREAK_WATCH ;
+            dbg -> hit_addr = addr > watch -> addr ? addr : watch -> addr ;
+            dbg -> hit_kind = kind ;
+            dbg -> hit_index = w ;
+            cancel_step_over(dbg) ;
+            return ;
+        }
+    }
+}
+
+//number in C syntax (0x200, 512), whole token
+static bool parse_num(const char *s , long *out) {
+    if ( !s) return false ;
+    char *end ;
+    *out = strtol(s, &end, 0) ;
+    return end != s && *end == '\0' ;
+}
+
+//V0-VF or I
+static bool parse_reg(const char *s , uint8_t *reg) {
+    if ( !s) return false ;
+    if ( (s[0] == 'I' || s[0] == 'i') && s[1] == '\0') {
+        *reg = DEBUG_REG_I ;
+        return true ;
+    }
+    if ( (s[0] == 'V' || s[0] == 'v') && s[1] && s[2] == '\0') {
+        char *end ;
+        const long r = strtol(&s[1], &end, 16) ;
+        if ( *end != '\0') return false ;
+        *reg = r ;
+        return true ;
+    }
+    return false ;
+}
+
+static bool parse_op(const char *s , cond_op_t *op) {
+    if ( !s) return false ;
+    for ( uint32_t o = 0 ; o < sizeof op_names / sizeof op_names[0] ; o ++) {
+        if ( strcmp(s, op_names[o]) == 0) {
+            *op = o ;
+            return true ;
+        }
+    }
+    return false ;
+}
+
+//"<reg> <op> <value>" from the remaining tokens
+static bool parse_cond(debug_cond_t *cond) {
+    long value ;
+    if ( !parse_reg(strtok(NULL, " \t\n"), &cond -> reg) || !parse_op(strtok(NULL, " \t\n"), &cond -> op) ||
+         !parse_num(strtok(NULL, " \t\n"), &value) || value < 0 || value > 0xFFFF) {
+        printf("expected <V0-VF|I> <==|!=|<|>|<=|>=> <value>\n") ;
+        return false ;
+    }
+    cond -> value = value ;
+    return true ;
+}
+
+static void print_cond(const debug_cond_t *cond) {
+    if ( cond -> reg == DEBUG_REG_I) printf("I ") ;
+    else printf("V%X ", cond -> reg) ;
+    printf("%s 0x%02X", op_names[cond -> op], cond -> value) ;
+    if ( cond -> addr == DEBUG_ANY_ADDR) printf(" anywhere\n") ;
+    else printf(" at 0x%03X\n", cond -> addr) ;
+}
+
+static void print_state(const chip8_t *chip8) {
+    const uint16_t pc = chip8 -> PC & 0xFFF ;
+    printf("PC 0x%03X: %02X%02X  I 0x%03X  DT %u  ST %u  SP %u\n", pc, chip8 -> ram[pc], chip8 -> ram[(pc + 1) & 0xFFF],
+           chip8 -> I, chip8 -> delay_timer, chip8 -> sound_timer, stack_depth(chip8)) ;
+    for ( uint32_t r = 0 ; r < 16 ; r ++) printf("V%X %02X%s", r, chip8 -> V[r], r == 7 || r == 15 ? "\n" : "  ") ;
+}
+
+static void print_list(const debugger_t *dbg) {
+    for ( uint32_t addr = 0 ; addr < 4096 ; addr ++)
+        if ( (dbg -> breakpoints[addr >> 3] >> (addr & 7)) & 1) printf("break 0x%03X\n", addr) ;
+    for ( uint32_t c = 0 ; c < dbg -> n_conds ; c ++) {
+        printf("c%u: ", c) ;
+        print_cond(&dbg -> conds[c]) ;
+    }
+    for ( uint32_t w = 0 ; w < dbg -> n_watches ; w ++) {
+        const debug_watch_t *watch = &dbg -> watches[w] ;
+        printf("w%u: 0x%03X-0x%03X %s%s\n", w, watch -> addr, watch -> addr + watch -> len - 1,
+               watch -> kinds & WATCH_READ ? "r" : "", watch -> kinds & WATCH_WRITE ? "w" : "") ;
+    }
+}
+
+static void print_help(void) {
+    puts("c                              continue\n"
+         "s                              step one instruction\n"
+         "n                              step, running 2NNN calls to their return\n"
+         "b <addr>                       toggle breakpoint at addr\n"
+         "b <addr> if <reg> <op> <val>   break at addr when the condition holds\n"
+         "if <reg> <op> <val>            break anywhere once the condition becomes true\n"
+         "w <addr> [len] [r|w|rw]        watch RAM read by DXYN/FX65, written by FX33/FX55\n"
+         "d [cN|wN]                      delete a condition or watch, everything without argument\n"
+         "l                              list breakpoints and watches\n"
+         "r                              registers\n"
+         "x <addr> [len]                 dump RAM\n"
+         "q                              quit emulator\n"
+         "reg is V0-VF or I, op is == != < > <= >=") ;
+}
+
+//why we stopped, printed when the prompt opens
+static void print_reason(const debugger_t *dbg , const chip8_t *chip8) {
+    switch ( dbg -> reason) {
+        case BREAK_PC:
+            printf("breakpoint at 0x%03X\n", chip8 -> PC & 0xFFF) ;
+            break ;
+        case BREAK_COND:
+            printf("c%u hit: ", dbg -> hit_index) ;
+            print_cond(&dbg -> conds[dbg -> hit_index]) ;
+            break ;
+        case BREAK_WATCH:
+            printf("w%u hit: opcode %04X %s 0x%03X\n", dbg -> hit_index, chip8 -> inst.opcode,
+                   dbg -> hit_kind == WATCH_READ ? "read" : "wrote", dbg -> hit_addr) ;
+            break ;
+        case BREAK_STEP:
+            break ;
+        case BREAK_USER:
+            printf("break at 0x%03X\n", chip8 -> PC & 0xFFF) ;
+            break ;
+        default:
+            printf("stopped\n") ;
+            break ;
+    }
+}
+
+emulator_state_t debugger_prompt(debugger_t *dbg , chip8_t *chip8 , const config_t config) {
+    char line[128] ;
+
+    print_reason(dbg, chip8) ;
+    print_state(chip8) ;
+
+    for (;;) {
+        printf("(chip8) ") ;
+        fflush(stdout) ;
+        if ( !fgets(line, sizeof line, stdin)) {
+            //no console: drop everything and let the machine run
+            debugger_init(dbg) ;
+            return RUNNING ;
+        }
+
+        const char *cmd = strtok(line, " \t\n") ;
+        if ( !cmd) continue ;
+
+        if ( strcmp(cmd, "c") == 0) {
+            dbg -> resume = true ;
+            return RUNNING ;
+        }
+        else if ( strcmp(cmd, "s") == 0 || strcmp(cmd, "n") == 0) {
+            const uint16_t pc = chip8 -> PC & 0xFFF ;
+            if ( cmd[0] == 'n' && (chip8 -> ram[pc] >> 4) == 0x2) {
+                //step over: run the call until it returns to the next instruction
+                dbg -> until_active = true ;
+                dbg -> until_pc = (pc + 2) & 0xFFF ;
+                dbg -> until_depth = stack_depth(chip8) ;
+                rebuild(dbg) ;
+                dbg -> resume = true ;
+                return RUNNING ;
+            }
+            dbg -> resume = true ;
+            run_instructions_debug(chip8, config, dbg, 1) ;
+            if ( dbg -> reason == BREAK_NONE) dbg -> reason = BREAK_STEP ;
+            return BREAK ;
+        }
+        else if ( strcmp(cmd, "b") == 0) {
+            long addr ;
+            if ( !parse_num(strtok(NULL, " \t\n"), &addr) || addr < 0 || addr > 0xFFF) {
+                printf("expected an address 0x000-0xFFF\n") ;
+                continue ;
+            }
+            const char *cond_kw = strtok(NULL, " \t\n") ;
+            if ( cond_kw && strcmp(cond_kw, "if") == 0) {
+                debug_cond_t cond = { .addr = addr } ;
+                if ( dbg -> n_conds == DEBUG_MAX_CONDS) printf("too many conditions\n") ;
+                else if ( parse_cond(&cond)) dbg -> conds[dbg -> n_conds ++] = cond ;
+            }
+            else {
+                dbg -> breakpoints[addr >> 3] ^= 1 << (addr & 7) ;
+                printf("breakpoint at 0x%03lX %s\n", addr, (dbg -> breakpoints[addr >> 3] >> (addr & 7)) & 1 ? "set" : "removed") ;
+            }
+            rebuild(dbg) ;
+        }
+        else if ( strcmp(cmd, "if") == 0) {
+            debug_cond_t cond = { .addr = DEBUG_ANY_ADDR } ;
+            if ( dbg -> n_conds == DEBUG_MAX_CONDS) printf("too many conditions\n") ;
+            else if ( parse_cond(&cond)) {
+                cond.was_true = cond_holds(&cond, chip8) ;
+                dbg -> conds[dbg -> n_conds ++] = cond ;
+                rebuild(dbg) ;
+            }
+        }
+        else if ( strcmp(cmd, "w") == 0) {
+            long addr , len = 1 ;
+            const char *len_arg , *kind_arg ;
+            if ( !parse_num(strtok(NULL, " \t\n"), &addr) || addr < 0 || addr > 0xFFF) {
+                printf("expected an address 0x000-0xFFF\n") ;
+                continue ;
+            }
+            len_arg = strtok(NULL, " \t\n") ;
+            kind_arg = len_arg ;
+            if ( parse_num(len_arg, &len)) kind_arg = strtok(NULL, " \t\n") ;
+            if ( len < 1 || addr + len > 0x1000) {
+                printf("watch must stay inside RAM\n") ;
+                continue ;
+            }
+            uint8_t kinds = WATCH_READ | WATCH_WRITE ;
+            if ( kind_arg && strcmp(kind_arg, "r") == 0) kinds = WATCH_READ ;
+            else if ( kind_arg && strcmp(kind_arg, "w") == 0) kinds = WATCH_WRITE ;
+            else if ( kind_arg && strcmp(kind_arg, "rw") != 0) {
+                printf("expected r, w or rw\n") ;
+                continue ;
+            }
+            if ( dbg -> n_watches == DEBUG_MAX_WATCHES) {
+                printf("too many watches\n") ;
+                continue ;
+            }
+            dbg -> watches[dbg -> n_watches ++] = (debug_watch_t) { .addr = addr, .len = len, .kinds = kinds } ;
+            rebuild(dbg) ;
+        }
+        else if ( strcmp(cmd, "d") == 0) {
+            const char *which = strtok(NULL, " \t\n") ;
+            long index ;
+            if ( !which) {
+                memset(dbg -> breakpoints, 0, sizeof dbg -> breakpoints) ;
+                dbg -> n_conds = 0 ;
+                dbg -> n_watches = 0 ;
+            }
+            else if ( which[0] == 'c' && parse_num(&which[1], &index) && index >= 0 && (uint32_t)index < dbg -> n_conds) {
+                memmove(&dbg -> conds[index], &dbg -> conds[index + 1], (dbg -> n_conds - index - 1) * sizeof dbg -> conds[0]) ;
+                dbg -> n_conds -- ;
+            }
+            else if ( which[0] == 'w' && parse_num(&which[1], &index) && index >= 0 && (uint32_t)index < dbg -> n_watches) {
+                memmove(&dbg -> watches[index], &dbg -> watches[index + 1], (dbg -> n_watches - index - 1) * sizeof dbg -> watches[0]) ;
+                dbg -> n_watches -- ;
+            }
+            else printf("no such condition or watch %s\n", which) ;
+            rebuild(dbg) ;
+        }
+        else if ( strcmp(cmd, "l") == 0) print_list(dbg) ;
+        else if ( strcmp(cmd, "r") == 0) print_state(chip8) ;
+        else if ( strcmp(cmd, "x") == 0) {
+            long addr , len = 16 ;
+            const char *len_arg ;
+            if ( !parse_num(strtok(NULL, " \t\n"), &addr) || addr < 0 || addr > 0xFFF) {
+                printf("expected an address 0x000-0xFFF\n") ;
+                continue ;
+            }
+            len_arg = strtok(NULL, " \t\n") ;
+            if ( len_arg && !parse_num(len_arg, &len)) len = 16 ;
+            if ( len > 0x1000 - addr) len = 0x1000 - addr ;
+            for ( long i = 0 ; i < len ; i ++) {
+                if ( i % 16 == 0) printf("%s0x%03lX:", i ? "\n" : "", addr + i) ;
+                printf(" %02X", chip8 -> ram[addr + i]) ;
+            }
+            if ( len > 0) printf("\n") ;
+        }
+        else if ( strcmp(cmd, "q") == 0) return QUIT ;
+        else print_help() ;
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+//interactive debugger: PC breakpoints, conditional breakpoints on V/I and RAM watchpoints
+//nothing is checked while it is disarmed, the frontend then runs the plain
+//run_instructions() loop; once armed it switches to run_instructions_debug(),
+//a separate instantiation of the hot loop with the checks compiled in
+//breakpoints are one bit per address, watchpoints are filtered through a mask of
+//64 byte RAM pages before the exact ranges are looked at
+
+#define DEBUG_MAX_CONDS   16
+#define DEBUG_MAX_WATCHES 16
+#define DEBUG_PAGE_SHIFT  6    //64 byte pages, 4096/64 = 64 pages = one uint64_t
+
+//why the debugger stopped
+typedef enum {
+    BREAK_NONE ,
+    BREAK_USER ,       //break key or --debug
+    BREAK_PC ,         //PC breakpoint
+    BREAK_COND ,       //conditional breakpoint
+    BREAK_WATCH ,      //watchpoint
+    BREAK_STEP ,       //single step or step over finished
+} break_reason_t ;
+
+//RAM access kinds for watchpoints
+typedef enum {
+    WATCH_READ = 1 ,   //DXYN sprite data, FX65
+    WATCH_WRITE = 2 ,  //FX33, FX55
+} watch_kind_t ;
+
+typedef enum {
+    COND_EQ , COND_NE , COND_LT , COND_GT , COND_LE , COND_GE ,
+} cond_op_t ;
+
+//break when reg op value holds, at addr or anywhere
+typedef struct {
+    uint16_t addr ;    //PC the condition is checked at, DEBUG_ANY_ADDR = every instruction
+    uint8_t reg ;      //0x0-0xF for V0-VF, 0x10 for I
+    cond_op_t op ;
+    uint16_t value ;
+    bool was_true ;    //anywhere conditions only fire when they become true
+} debug_cond_t ;
+
+#define DEBUG_ANY_ADDR 0xFFFF
+#define DEBUG_REG_I    0x10
+
+typedef struct {
+    uint16_t addr ;
+    uint16_t len ;
+    uint8_t kinds ;    //watch_kind_t bits
+} debug_watch_t ;
+
+typedef struct {
+    bool armed ;                 //anything to check, else the plain loop runs
+    uint8_t breakpoints[4096/8] ;//unconditional PC breakpoints
+    uint8_t check[4096/8] ;      //addresses with a breakpoint or an address bound condition
+    debug_cond_t conds[DEBUG_MAX_CONDS] ;
+    uint32_t n_conds ;
+    uint32_t n_global ;          //conditions checked at every address
+    debug_watch_t watches[DEBUG_MAX_WATCHES] ;
+    uint32_t n_watches ;
+    uint64_t watch_pages ;       //bit p set: some watch touches RAM page p
+
+    bool resume ;                //don't stop before the next instruction (continuing from a break)
+    bool until_active ;          //step over: run until PC == until_pc at stack depth <= until_depth
+    uint16_t until_pc ;
+    uint32_t until_depth ;
+
+    break_reason_t reason ;      //set when the loop stopped
+    uint16_t hit_addr ;          //watchpoint: first address touched
+    watch_kind_t hit_kind ;
+    uint32_t hit_index ;         //condition or watch that fired
+} debugger_t ;
+
+void debugger_init(debugger_t *dbg) ;
+
+//break key or --debug: stop with BREAK_USER, dropping a continue or step over left from the last prompt
+void debugger_user_break(debugger_t *dbg) ;
+
+//emulate up to count instructions with every breakpoint and watchpoint checked
+//returns how many ran, stops early on a display wait or when dbg -> reason is set
+uint32_t run_instructions_debug(chip8_t *chip8 , const config_t config , debugger_t *dbg , uint32_t count) ;
+
+//console prompt, reads commands from stdin until one resumes the machine
+//returns RUNNING to continue, BREAK after a single step, QUIT to exit
+emulator_state_t debugger_prompt(debugger_t *dbg , chip8_t *chip8 , const config_t config) ;
+
+//slow paths of the checks below, only reached when something is armed there
+bool debugger_check(debugger_t *dbg , const chip8_t *chip8) ;
+void debugger_watch_hit(debugger_t *dbg , uint16_t addr , uint16_t len , watch_kind_t kind) ;
+
+//should the loop stop before executing the instruction at PC
+static inline bool debugger_break_due(debugger_t *dbg , const chip8_t *chip8) {
+    if ( dbg -> resume) {
+        dbg -> resume = false ;
+        return false ;
+    }
+    const uint16_t pc = chip8 -> PC & 0xFFF ;
+    if ( !((dbg -> check[pc >> 3] >> (pc & 7)) & 1) && dbg -> n_global == 0 && !dbg -> until_active) return false ;
+    return debugger_check(dbg, chip8) ;
+}
+
+//pages touched by the RAM range [addr, addr + len), len <= 16 spans at most 2 pages
+static inline uint64_t debugger_page_span(uint16_t addr , uint16_t len) {
+    return (1ull << ((addr & 0xFFF) >> DEBUG_PAGE_SHIFT)) | (1ull << (((addr + len - 1) & 0xFFF) >> DEBUG_PAGE_SHIFT)) ;
+}
+
+#endif //DEBUGGER_H
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hud.h"
+
+//3x5 font, one byte per row, bit 2 is the leftmost pixel
+static const char font_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ./%:-" ;
+static const uint8_t font[][5] = {
+    {7,5,5,5,7}, {2,6,2,2,7}, {7,1,7,4,7}, {7,1,7,1,7}, {5,5,7,1,1},   //0-4
+    {7,4,7,1,7}, {7,4,7,5,7}, {7,1,1,1,1}, {7,5,7,5,7}, {7,5,7,1,7},   //5-9
+    {2,5,7,5,5}, {6,5,6,5,6}, {3,4,4,4,3}, {6,5,5,5,6}, {7,4,6,4,7},   //A-E
+    {7,4,6,4,4}, {3,4,5,5,3}, {5,5,7,5,5}, {7,2,2,2,7}, {1,1,1,5,2},   //F-J
+    {5,5,6,5,5}, {4,4,4,4,7}, {5,7,7,5,5}, {6,5,5,5,5}, {2,5,5,5,2},   //K-O
+    {6,5,6,4,4}, {2,5,5,6,3}, {6,5,6,5,5}, {3,4,2,1,6}, {7,2,2,2,2},   //P-T
+    {5,5,5,5,7}, {5,5,5,5,2}, {5,5,7,7,5}, {5,5,2,5,5}, {5,5,2,2,2},   //U-Y
+    {7,1,2,4,7}, {0,0,0,0,2}, {1,1,2,4,4}, {5,1,2,4,5}, {0,2,0,2,0},   //Z ./%:
+    {0,0,7,0,0},                                                       //-
+} ;
+
+//rebuild the rect list from hud->text
+static void layout(hud_t *hud) {
+    const int advance = 4 * HUD_PIXEL ;         //3 pixel glyph + 1 pixel gap
+    const int line_height = 7 * HUD_PIXEL ;
+    const int margin = 2 * HUD_PIXEL ;
+    int widest = 0 ;
+
+    hud -> n_rects = 0 ;
+    for ( int line = 0 ; line < HUD_LINES ; line ++) {
+        const char *s = hud -> text[line] ;
+        const int len = (int)strlen(s) ;
+        if ( len > widest) widest = len ;
+
+        for ( int c = 0 ; c < len ; c ++) {
+            const char *glyph = strchr(font_chars, s[c]) ;
+            if ( s[c] == ' ' || !glyph) continue ;
+            const uint8_t *rows = font[glyph - font_chars] ;
+            for ( int y = 0 ; y < 5 ; y ++)
+                for ( int x = 0 ; x < 3 ; x ++)
+                    if ( rows[y] & (4 >> x)) hud -> rects[hud -> n_rects ++] = (SDL_Rect) {
+                        .x = margin + c * advance + x * HUD_PIXEL ,
+                        .y = margin + line * line_height + y * HUD_PIXEL ,
+                        .w = HUD_PIXEL ,
+                        .h = HUD_PIXEL ,
+                    } ;
+        }
+    }
+    hud -> box = (SDL_Rect) { .x = 0, .y = 0, .w = widest * advance + 2 * margin, .h = HUD_LINES * line_height + margin } ;
+}
+
+void hud_update(hud_t *hud , const metrics_rates_t *rates) {
+    //instructions per second in K or M, whichever fits
+    char ips[16] ;
+    if ( rates -> ips >= 1e6) snprintf(ips, sizeof ips, "%.2fM", rates -> ips / 1e6) ;
+    else snprintf(ips, sizeof ips, "%.1fK", rates -> ips / 1e3) ;
+
+    snprintf(hud -> text[0], HUD_COLS, "IPS %s", ips) ;
+    snprintf(hud -> text[1], HUD_COLS, "FPS %.1f/60 SHOWN %.1f", rates -> fps, rates -> presents) ;
+    snprintf(hud -> text[2], HUD_COLS, "EMU %.2fMS DRAW %.2fMS SLEEP %.1fMS", rates -> emu_ms, rates -> render_ms, rates -> sleep_ms) ;
+    snprintf(hud -> text[3], HUD_COLS, "UNDERRUNS %llu DROPPED %llu", (unsigned long long)rates -> underruns, (unsigned long long)rates -> dropped) ;
+    //latency is only measured on key presses, keep the last value until the next one
+    if ( rates -> latency_ms >= 0) snprintf(hud -> text[4], HUD_COLS, "KEY TO PHOTON %.1fMS", rates -> latency_ms) ;
+    else if ( hud -> text[4][0] == 0) snprintf(hud -> text[4], HUD_COLS, "KEY TO PHOTON -") ;
+    layout(hud) ;
+}
+
+void hud_draw(const hud_t *hud , SDL_Renderer *renderer) {
+    if ( !hud -> visible) return ;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) ;
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160) ;
+    SDL_RenderFillRect(renderer, &hud -> box) ;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE) ;
+    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255) ;
+    SDL_RenderFillRects(renderer, hud -> rects, hud -> n_rects) ;
+}
@@ -0,0 +1,34 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "metrics.h"
+
+//performance overlay drawn over the top left corner of the window
+//text is a built in 3x5 font drawn as filled rects, so no font library is needed;
+//the rects are only rebuilt when the text changes (once a second), a present
+//just fills them
+
+#define HUD_LINES 5
+#define HUD_COLS  40
+#define HUD_PIXEL 3     //window pixels per font pixel
+
+typedef struct {
+    bool visible ;
+    char text[HUD_LINES][HUD_COLS] ;
+    SDL_Rect box ;                              //translucent background
+    SDL_Rect rects[HUD_LINES * HUD_COLS * 15] ; //lit font pixels
+    int n_rects ;
+} hud_t ;
+
+//format new rates into the overlay text
+void hud_update(hud_t *hud , const metrics_rates_t *rates) ;
+
+//draw the overlay, call between rendering the frame and SDL_RenderPresent()
+void hud_draw(const hud_t *hud , SDL_Renderer *renderer) ;
+
+#endif //HUD_H
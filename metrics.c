@@ -0,0 +1,84 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "metrics.h"
+
+//how a counter is exported, times are exported in seconds
+typedef enum {
+    UNIT_COUNT ,
+    UNIT_TICKS ,
+    UNIT_MS ,
+} unit_t ;
+
+static const struct {
+    const char *name ;
+    const char *help ;
+    unit_t unit ;
+} metric_info[METRIC_COUNT] = {
+    [METRIC_INSTRUCTIONS] = { "chip8_instructions_total",   "CHIP8 instructions executed", UNIT_COUNT },
+    [METRIC_FRAMES]       = { "chip8_frames_total",         "Emulated 60Hz frames", UNIT_COUNT },
+    [METRIC_PRESENTS]     = { "chip8_presents_total",       "Frames presented", UNIT_COUNT },
+    [METRIC_DROPPED]      = { "chip8_dropped_frames_total", "Presents dropped by frame skip", UNIT_COUNT },
+    [METRIC_UNDERRUNS]    = { "chip8_audio_underruns_total","Late audio callbacks", UNIT_COUNT },
+    [METRIC_EMU_TICKS]    = { "chip8_emulation_seconds_total", "Host time spent emulating", UNIT_TICKS },
+    [METRIC_RENDER_TICKS] = { "chip8_render_seconds_total", "Host time spent rendering frames", UNIT_TICKS },
+    [METRIC_SLEEP_TICKS]  = { "chip8_sleep_seconds_total",  "Host time spent sleeping or waiting for vsync", UNIT_TICKS },
+    [METRIC_LATENCY_SAMPLES] = { "chip8_input_latency_samples_total", "Key presses measured by the latency probe", UNIT_COUNT },
+    [METRIC_LATENCY_MS]   = { "chip8_input_latency_seconds_total", "Summed key to present time", UNIT_MS },
+} ;
+
+void metrics_snapshot(const metrics_t *metrics , uint64_t ticks , metrics_snapshot_t *snapshot) {
+    for ( uint32_t i = 0 ; i < METRIC_COUNT ; i ++)
+        snapshot -> counters[i] = atomic_load_explicit(&metrics -> counters[i], memory_order_relaxed) ;
+    snapshot -> ticks = ticks ;
+}
+
+void metrics_rates(const metrics_snapshot_t *prev , const metrics_snapshot_t *cur , uint64_t ticks_per_second , metrics_rates_t *rates) {
+    uint64_t d[METRIC_COUNT] ;
+    for ( uint32_t i = 0 ; i < METRIC_COUNT ; i ++) d[i] = cur -> counters[i] - prev -> counters[i] ;
+    const double seconds = cur -> ticks > prev -> ticks ? (double)(cur -> ticks - prev -> ticks) / ticks_per_second : 1.0 ;
+    const double ms_per_tick = 1000.0 / ticks_per_second ;
+    const double frames = d[METRIC_FRAMES] ? (double)d[METRIC_FRAMES] : 1.0 ;
+    const double presents = d[METRIC_PRESENTS] ? (double)d[METRIC_PRESENTS] : 1.0 ;
+
+    *rates = (metrics_rates_t) {
+        .ips = d[METRIC_INSTRUCTIONS] / seconds ,
+        .fps = d[METRIC_FRAMES] / seconds ,
+        .presents = d[METRIC_PRESENTS] / seconds ,
+        .emu_ms = d[METRIC_EMU_TICKS] * ms_per_tick / frames ,
+        .render_ms = d[METRIC_RENDER_TICKS] * ms_per_tick / presents ,
+        .sleep_ms = d[METRIC_SLEEP_TICKS] * ms_per_tick / frames ,
+        .latency_ms = d[METRIC_LATENCY_SAMPLES] ? (double)d[METRIC_LATENCY_MS] / d[METRIC_LATENCY_SAMPLES] : -1.0 ,
+        .underruns = cur -> counters[METRIC_UNDERRUNS] ,
+        .dropped = cur -> counters[METRIC_DROPPED] ,
+    } ;
+}
+
+bool metrics_write(const metrics_snapshot_t *snapshot , uint64_t ticks_per_second , const char *path) {
+    char tmp[1024] ;
+    if ( snprintf(tmp, sizeof tmp, "%s.tmp", path) >= (int)sizeof tmp) return false ;
+
+    FILE *f = fopen(tmp, "w") ;
+    if ( !f) return false ;
+    for ( uint32_t i = 0 ; i < METRIC_COUNT ; i ++) {
+        fprintf(f, "# HELP %s %s.\n# TYPE %s counter\n", metric_info[i].name, metric_info[i].help, metric_info[i].name) ;
+        switch ( metric_info[i].unit) {
+            case UNIT_TICKS: fprintf(f, "%s %.6f\n", metric_info[i].name, (double)snapshot -> counters[i] / ticks_per_second) ; break ;
+            case UNIT_MS:    fprintf(f, "%s %.3f\n", metric_info[i].name, snapshot -> counters[i] / 1000.0) ; break ;
+            default:         fprintf(f, "%s %" PRIu64 "\n", metric_info[i].name, snapshot -> counters[i]) ; break ;
+        }
+    }
+    if ( fclose(f) != 0) {
+        remove(tmp) ;
+        return false ;
+    }
+
+#ifdef _WIN32
+    remove(path) ; //rename() doesn't replace an existing file on windows
+#endif
+    if ( rename(tmp, path) != 0) {
+        remove(tmp) ;
+        return false ;
+    }
+    return true ;
+}
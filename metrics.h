@@ -0,0 +1,61 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//performance counters, always on
+//every counter is a monotonic relaxed atomic: bumping one is a single locked add, and
+//the audio thread can count underruns without a lock; rates are derived by whoever
+//reads them from the difference of two snapshots
+
+typedef enum {
+    METRIC_INSTRUCTIONS ,   //CHIP8 instructions executed
+    METRIC_FRAMES ,         //emulated 60Hz frames
+    METRIC_PRESENTS ,       //frames shown on screen
+    METRIC_DROPPED ,        //presents dropped by frame skip
+    METRIC_UNDERRUNS ,      //audio callbacks that came late, the device ran dry
+    METRIC_EMU_TICKS ,      //host time in the instruction batch and timers
+    METRIC_RENDER_TICKS ,   //host time drawing frames, without the present
+    METRIC_SLEEP_TICKS ,    //host time sleeping for the next deadline or blocked on vsync
+    METRIC_LATENCY_SAMPLES ,//key presses the latency probe saw on screen
+    METRIC_LATENCY_MS ,     //sum of their key to present times in ms
+    METRIC_COUNT ,
+} metric_t ;
+
+typedef struct {
+    _Atomic uint64_t counters[METRIC_COUNT] ;
+} metrics_t ;
+
+//counter values at one point in time
+typedef struct {
+    uint64_t counters[METRIC_COUNT] ;
+    uint64_t ticks ;          //performance counter when taken
+} metrics_snapshot_t ;
+
+//rates between two snapshots
+typedef struct {
+    double ips ;              //instructions per second
+    double fps ;              //emulated frames per second, target 60
+    double presents ;         //presents per second
+    double emu_ms ;           //per emulated frame: host ms in emulation
+    double render_ms ;        //per present: host ms drawing the frame
+    double sleep_ms ;         //per emulated frame: host ms asleep
+    double latency_ms ;       //mean key to present time, negative when no key was measured
+    uint64_t underruns ;      //totals since start
+    uint64_t dropped ;
+} metrics_rates_t ;
+
+static inline void metrics_add(metrics_t *metrics , metric_t metric , uint64_t n) {
+    atomic_fetch_add_explicit(&metrics -> counters[metric], n, memory_order_relaxed) ;
+}
+
+void metrics_snapshot(const metrics_t *metrics , uint64_t ticks , metrics_snapshot_t *snapshot) ;
+void metrics_rates(const metrics_snapshot_t *prev , const metrics_snapshot_t *cur , uint64_t ticks_per_second , metrics_rates_t *rates) ;
+
+//write the counters to path in Prometheus text format, as a node_exporter textfile collector picks up
+//written to a temporary file and renamed, so a scraper never sees half a file
+bool metrics_write(const metrics_snapshot_t *snapshot , uint64_t ticks_per_second , const char *path) ;
+
+#endif //METRICS_H
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scaler.h"
+#include "simd.h"
+
+#define PX_PER_VEC (VBYTES/4)   //RGBA8888 pixels per vector
+
+//fill count pixels with one color
+static inline void fill_px(uint32_t *dst, const uint32_t color, const uint32_t count) {
+    const v32_t c = (v32_t){0} + color ;
+    uint32_t i = 0 ;
+    for ( ; i + PX_PER_VEC <= count ; i += PX_PER_VEC) st32(dst + i, c) ;
+    for ( ; i < count ; i ++) dst[i] = color ;
+}
+
+//scanline: halve r, g and b, keep alpha
+static void dim_row(uint32_t *dst, const uint32_t *src, const uint32_t count) {
+    uint32_t i = 0 ;
+    for ( ; i + PX_PER_VEC <= count ; i += PX_PER_VEC) {
+        const v32_t v = ld32(src + i) ;
+        st32(dst + i, ((v >> 1) & 0x7F7F7F00) | (v & 0xFF)) ;
+    }
+    for ( ; i < count ; i ++) dst[i] = ((src[i] >> 1) & 0x7F7F7F00) | (src[i] & 0xFF) ;
+}
+
+bool scaler_init(scaler_t *s, const config_t config) {
+    *s = (scaler_t) {
+        .src_w = config.window_width,
+        .src_h = config.window_height,
+        .scale = config.scale_factor,
+        .out_w = config.window_width * config.scale_factor,
+        .out_h = config.window_height * config.scale_factor,
+        .bg_color = config.bg_color,
+        .outlines = config.pixel_outlines,
+        .scanlines = config.scanlines,
+        .decay = config.phosphor_decay,
+    } ;
+
+    const uint32_t n = s -> src_w * s -> src_h ;
+    s -> pixels = malloc((size_t)s -> out_w * s -> out_h * sizeof *s -> pixels) ;
+    s -> intensity = calloc(2*n, 1) ;   //second half: intensity as last rendered
+    s -> rows = malloc((size_t)4 * s -> out_w * sizeof *s -> rows) ;
+    if ( !s -> pixels || !s -> intensity || !s -> rows) {
+        scaler_free(s) ;
+        return false ;
+    }
+
+    //linear blend bg -> fg per channel
+    for ( uint32_t i = 0 ; i < 256 ; i ++) {
+        uint32_t c = 0 ;
+        for ( uint32_t shift = 0 ; shift < 32 ; shift += 8) {
+            const uint32_t bg = (config.bg_color >> shift) & 0xFF ;
+            const uint32_t fg = (config.fg_color >> shift) & 0xFF ;
+            c |= ((bg*(255 - i) + fg*i + 127) / 255) << shift ;
+        }
+        s -> palette[i] = c ;
+    }
+    return true ;
+}
+
+void scaler_free(scaler_t *s) {
+    free(s -> pixels) ;
+    free(s -> intensity) ;
+    free(s -> rows) ;
+    s -> pixels = NULL ;
+    s -> intensity = NULL ;
+    s -> rows = NULL ;
+}
+
+//phosphor: lit pixels jump to full intensity, unlit ones decay by decay/256 per emulated frame
+static void update_intensity(scaler_t *s, const bool *display) {
+    const uint32_t n = s -> src_w * s -> src_h ;
+    const v8_t full = (v8_t){0} + 255 ;
+
+    //decay^frames in the same 1/256 units, 256 keeps the intensity when no frame went by
+    uint32_t factor = s -> decay ? 256 : 0 ;
+    for ( uint32_t f = 0 ; f < s -> frames && factor ; f ++) factor = factor * s -> decay >> 8 ;
+    s -> frames = 0 ;
+    const v16_t keep = (v16_t){0} + (uint16_t)factor ;
+
+    uint32_t k = 0 ;
+    for ( ; k + VBYTES <= n ; k += VBYTES) {
+        uint8_t decayed[VBYTES] ;
+        narrow16(decayed, (widen8(s -> intensity + k) * keep) >> 8) ;
+        narrow16(decayed + VBYTES/2, (widen8(s -> intensity + k + VBYTES/2) * keep) >> 8) ;
+        const v8_t lit = (v8_t)(ld8(display + k) != 0) ;
+        st8(s -> intensity + k, blend8(lit, full, ld8(decayed))) ;
+    }
+    for ( ; k < n ; k ++)
+        s -> intensity[k] = display[k] ? 255 : (s -> intensity[k] * factor) >> 8 ;
+}
+
+void scaler_render(scaler_t *s, const bool *display) {
+    update_intensity(s, display) ;
+
+    const uint32_t n = s -> src_w * s -> src_h ;
+    const uint32_t w = s -> out_w, scale = s -> scale ;
+    uint32_t *body = s -> rows, *edge = s -> rows + w ;
+    uint32_t *body_dim = s -> rows + 2*w, *edge_dim = s -> rows + 3*w ;
+    const uint32_t dark_from = scale - scale/3 ;   //first scanline row inside a CHIP8 pixel
+
+    for ( uint32_t y = 0 ; y < s -> src_h ; y ++) {
+        const uint8_t *in = s -> intensity + y*s -> src_w ;
+        uint8_t *shown = s -> intensity + n + y*s -> src_w ;
+
+        //an unchanged CHIP8 row produces the same output rows as last time
+        if ( s -> primed && memcmp(in, shown, s -> src_w) == 0) continue ;
+        memcpy(shown, in, s -> src_w) ;
+
+        //build the row templates once per CHIP8 row
+        for ( uint32_t x = 0 ; x < s -> src_w ; x ++) {
+            uint32_t *b = body + x*scale, *e = edge + x*scale ;
+            fill_px(b, s -> palette[in[x]], scale) ;
+            if ( s -> outlines && in[x] == 255) {
+                //lit pixel: border in bg color, like SDL_RenderDrawRect over the fill
+                b[0] = b[scale - 1] = s -> bg_color ;
+                fill_px(e, s -> bg_color, scale) ;
+            }
+            else if ( s -> outlines) {
+                memcpy(e, b, scale * sizeof *e) ;
+            }
+        }
+        if ( s -> scanlines) {
+            dim_row(body_dim, body, w) ;
+            if ( s -> outlines) dim_row(edge_dim, edge, w) ;
+        }
+
+        //replicate templates to the scale output rows
+        uint32_t *out = s -> pixels + (size_t)y*scale*w ;
+        for ( uint32_t r = 0 ; r < scale ; r ++) {
+            const bool is_edge = s -> outlines && (r == 0 || r == scale - 1) ;
+            const bool is_dark = s -> scanlines && r >= dark_from ;
+            const uint32_t *src = is_dark ? (is_edge ? edge_dim : body_dim) : (is_edge ? edge : body) ;
+            memcpy(out + (size_t)r*w, src, w * sizeof *out) ;
+        }
+    }
+    s -> primed = true ;
+}
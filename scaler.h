@@ -0,0 +1,39 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+//software scaler: expands the CHIP8 bitmap to window resolution in one pass
+//output is RGBA8888 (same packing as config_t colors), ready for one texture upload
+
+typedef struct {
+    uint32_t src_w, src_h ;   //CHIP8 resolution
+    uint32_t scale ;          //window pixels per CHIP8 pixel
+    uint32_t out_w, out_h ;   //output resolution, pitch is out_w*4 bytes
+    uint32_t *pixels ;        //output image
+    uint8_t *intensity ;      //phosphor intensity per CHIP8 pixel, 255 = lit
+    uint32_t *rows ;          //4 row templates: body, edge, and their scanline dimmed copies
+    uint32_t palette[256] ;   //intensity -> color, bg_color at 0 and fg_color at 255
+    uint32_t bg_color ;
+    bool outlines ;           //pixel grid: lit pixels get a bg colored border
+    bool scanlines ;          //darken the bottom third of every CHIP8 row
+    uint8_t decay ;           //phosphor persistence per emulated frame, 0 = off, 255 = longest
+    uint32_t frames ;         //emulated frames since the last render, each one decays the phosphor once
+    bool primed ;             //pixels hold a full render, unchanged rows can be skipped
+} scaler_t ;
+
+bool scaler_init(scaler_t *scaler, const config_t config) ;
+void scaler_free(scaler_t *scaler) ;
+
+//one emulated 60Hz frame went by, so the phosphor fades at the emulated rate however often frames are presented
+static inline void scaler_tick(scaler_t *scaler) {
+    scaler -> frames ++ ;
+}
+
+//render display (src_w*src_h pixels) into scaler->pixels
+void scaler_render(scaler_t *scaler, const bool *display) ;
+
+#endif //SCALER_H
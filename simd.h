@@ -0,0 +1,59 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+//portable vector types, gcc lowers these to SSE2 (16 byte vectors) or
+//AVX2 (32 byte vectors, build with -mavx2) and to plain code elsewhere
+
+#if defined(__AVX2__)
+#define VBYTES 32
+#else
+#define VBYTES 16
+#endif
+
+typedef uint8_t  v8_t  __attribute__((vector_size(VBYTES))) ;   //VBYTES lanes of 8 bit
+typedef uint16_t v16_t __attribute__((vector_size(VBYTES))) ;   //VBYTES/2 lanes of 16 bit
+typedef uint32_t v32_t __attribute__((vector_size(VBYTES))) ;   //VBYTES/4 lanes of 32 bit
+typedef uint8_t  h8_t  __attribute__((vector_size(VBYTES/2))) ; //8 bit chunk to widen to 16 bit
+typedef int8_t   hm8_t __attribute__((vector_size(VBYTES/2))) ; //8 bit mask chunk to widen to 16 bit
+typedef int16_t  vm16_t __attribute__((vector_size(VBYTES))) ;
+typedef float    vf_t  __attribute__((vector_size(VBYTES))) ;   //VBYTES/4 lanes of float
+
+#define VFLOATS (VBYTES/4)
+
+//unaligned loads/stores, buffers come from plain malloc
+static inline v8_t ld8(const void *p) { v8_t v ; memcpy(&v, p, sizeof v) ; return v ; }
+static inline void st8(void *p, v8_t v) { memcpy(p, &v, sizeof v) ; }
+static inline v16_t ld16(const void *p) { v16_t v ; memcpy(&v, p, sizeof v) ; return v ; }
+static inline void st16(void *p, v16_t v) { memcpy(p, &v, sizeof v) ; }
+static inline v32_t ld32(const void *p) { v32_t v ; memcpy(&v, p, sizeof v) ; return v ; }
+static inline void st32(void *p, v32_t v) { memcpy(p, &v, sizeof v) ; }
+static inline vf_t ldf(const void *p) { vf_t v ; memcpy(&v, p, sizeof v) ; return v ; }
+static inline void stf(void *p, vf_t v) { memcpy(p, &v, sizeof v) ; }
+
+//widen VBYTES/2 entries of an 8 bit array to 16 bit
+static inline v16_t widen8(const void *p) {
+    h8_t h ;
+    memcpy(&h, p, sizeof h) ;
+    return __builtin_convertvector(h, v16_t) ;
+}
+
+//widen VBYTES/2 entries of a 0x00/0xFF mask to 0x0000/0xFFFF
+static inline v16_t widen_mask(const void *p) {
+    hm8_t h ;
+    memcpy(&h, p, sizeof h) ;
+    return (v16_t)__builtin_convertvector(h, vm16_t) ;
+}
+
+//narrow VBYTES/2 16 bit entries to 8 bit (truncating) and store them
+static inline void narrow16(void *p, v16_t v) {
+    const h8_t h = __builtin_convertvector(v, h8_t) ;
+    memcpy(p, &h, sizeof h) ;
+}
+
+static inline v8_t blend8(v8_t m, v8_t a, v8_t b) { return (a & m) | (b & ~m) ; }
+static inline v16_t blend16(v16_t m, v16_t a, v16_t b) { return (a & m) | (b & ~m) ; }
+
+#endif //SIMD_H